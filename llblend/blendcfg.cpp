@@ -40,6 +40,8 @@
 #include "blendcfg.hpp"
 
 #include <assert.h>
+#include <stdlib.h>
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
 #include <sstream>
@@ -50,6 +52,7 @@
     const char SLASH_CHAR('\\');
     #include <assert.h>
     #define strncasecmp _strnicmp
+    #define strcasecmp _stricmp
     #if !defined(S_ISREG) && defined(S_IFMT) && defined(S_IFREG)
         #define S_ISREG(m) (((m)&S_IFMT) == S_IFREG)
     #endif
@@ -159,6 +162,10 @@ static JsonToken parseJson(JsonBuffer& buffer, JsonFields& jsonFields) {
             getJsonArray(buffer, *pJsonArray);
         } break;
         case ']':
+            if (! fieldValue.empty()) {
+                buffer.pos--;   // Last array value, return ']' on next call
+                return fieldValue;
+            }
             return END_ARRAY;
         }
     }
@@ -184,6 +191,49 @@ bool BlendCfg::parseConfig(const lstring& cfgFilename) {
 
                 parseJson(buffer, fields);
                 in.close();
+
+                float value;
+                if (getNumber("decay", value)) {
+                    setDecay(value);
+                }
+                JsonFields::const_iterator it = fields.find(JsonValue("overlay"));
+                if (it != fields.end() && it->second->mJtype == JsonBase::Value) {
+                    setOverlayMode(((const JsonValue*)it->second)->c_str());
+                }
+                it = fields.find(JsonValue("mode"));
+                if (it != fields.end() && it->second->mJtype == JsonBase::Value) {
+                    setTemporalMode(((const JsonValue*)it->second)->c_str());
+                }
+                if (getNumber("hold-index", value)) {
+                    holdIndex = (unsigned)std::max(0.0f, std::min(value, 255.0f));
+                }
+                if (getNumber("hold-frames", value)) {
+                    holdFrames = (unsigned)std::max(0.0f, value);
+                }
+                it = fields.find(JsonValue("gamma"));
+                if (it != fields.end() && it->second->mJtype == JsonBase::Value) {
+                    setGamma(((const JsonValue*)it->second)->c_str());
+                }
+                it = fields.find(JsonValue("layers"));
+                if (it != fields.end() && it->second->mJtype == JsonBase::Array) {
+                    for (const JsonBase* layer : *(const JsonArray*)it->second) {
+                        if (layer->mJtype == JsonBase::Value) {
+                            addLayer(((const JsonValue*)layer)->c_str());
+                        }
+                    }
+                }
+                it = fields.find(JsonValue("overlay-palette"));
+                if (it != fields.end()) {
+                    setOverlayPalette(it->second);
+                }
+                it = fields.find(JsonValue("classes"));
+                if (it != fields.end() && it->second->mJtype == JsonBase::Array) {
+                    for (const JsonBase* cls : *(const JsonArray*)it->second) {
+                        if (cls->mJtype == JsonBase::Value) {
+                            addClass(((const JsonValue*)cls)->c_str());
+                        }
+                    }
+                }
                 return true;
             } else {
                 cerr << "Config " << strerror(errno) << ", Unable to open " << cfgFilename << endl;
@@ -201,22 +251,246 @@ void BlendCfg::print() {
 }
 
 // -------------------------------------------------------------------------------------------------
+// Get top level numeric json field, ex:  "decay": 0.99
+bool BlendCfg::getNumber(const char* key, float& value) const {
+    JsonFields::const_iterator it = fields.find(JsonValue(key));
+    if (it != fields.end() && it->second->mJtype == JsonBase::Value) {
+        const JsonValue& jsonValue = *(const JsonValue*)it->second;
+        char* endPtr;
+        value = strtof(jsonValue.c_str(), &endPtr);
+        return endPtr != jsonValue.c_str();
+    }
+    return false;
+}
+
+// -------------------------------------------------------------------------------------------------
+void BlendCfg::setDecay(float percent) {
+    decay = std::max(0.0f, std::min(percent, 1.0f));
+}
+
+// -------------------------------------------------------------------------------------------------
+// Overlay mode by name, none, p32, lazy, tiled, premul, a16, planar or index
+bool BlendCfg::setOverlayMode(const char* name) {
+    if (strcasecmp(name, "none") == 0) {
+        overlayMode = OVERLAY_NONE;
+    } else if (strcasecmp(name, "p32") == 0) {
+        overlayMode = OVERLAY_P32;
+    } else if (strcasecmp(name, "lazy") == 0) {
+        overlayMode = OVERLAY_LAZY;
+    } else if (strcasecmp(name, "tiled") == 0) {
+        overlayMode = OVERLAY_TILED;
+    } else if (strcasecmp(name, "premul") == 0) {
+        overlayMode = OVERLAY_PREMUL;
+    } else if (strcasecmp(name, "a16") == 0) {
+        overlayMode = OVERLAY_A16;
+    } else if (strcasecmp(name, "planar") == 0) {
+        overlayMode = OVERLAY_PLANAR;
+    } else if (strcasecmp(name, "index") == 0) {
+        overlayMode = OVERLAY_INDEX;
+    } else {
+        cerr << "Unknown overlay mode " << name << ", expect none, p32, lazy, tiled, premul, a16, planar or index" << endl;
+        return false;
+    }
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Temporal blend mode by name, over, max, mean, last or hold
+bool BlendCfg::setTemporalMode(const char* name) {
+    if (strcasecmp(name, "over") == 0) {
+        temporalMode = TEMPORAL_OVER;
+    } else if (strcasecmp(name, "max") == 0) {
+        temporalMode = TEMPORAL_MAX;
+    } else if (strcasecmp(name, "mean") == 0) {
+        temporalMode = TEMPORAL_MEAN;
+    } else if (strcasecmp(name, "last") == 0) {
+        temporalMode = TEMPORAL_LAST;
+    } else if (strcasecmp(name, "hold") == 0) {
+        temporalMode = TEMPORAL_HOLD;
+    } else {
+        cerr << "Unknown blend mode " << name << ", expect over, max, mean, last or hold" << endl;
+        return false;
+    }
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Hold mode threshold, <index>,<frames>  ex: 6,12
+bool BlendCfg::setHold(const char* value) {
+    char* endPtr;
+    unsigned index = (unsigned)strtoul(value, &endPtr, 10);
+    if (endPtr == value || *endPtr != ',' || index > 255) {
+        cerr << "Bad hold " << value << ", expect <index>,<frames>" << endl;
+        return false;
+    }
+    holdIndex = index;
+    holdFrames = (unsigned)strtoul(endPtr + 1, nullptr, 10);
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Blend over color space by name, srgb mixes the encoded bytes, linear mixes linear light.
+bool BlendCfg::setGamma(const char* name) {
+    if (strcasecmp(name, "srgb") == 0) {
+        linearLight = false;
+    } else if (strcasecmp(name, "linear") == 0) {
+        linearLight = true;
+    } else {
+        cerr << "Unknown gamma " << name << ", expect srgb or linear" << endl;
+        return false;
+    }
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+static const char* const COMPOSITE_NAMES[COMPOSITE_OPS] = {
+    "over", "in", "out", "atop", "xor", "plus", "multiply", "screen"
+};
+
+const char* BlendCfg::toString(CompositeOp op) {
+    return (op < COMPOSITE_OPS) ? COMPOSITE_NAMES[op] : "?";
+}
+
+// -------------------------------------------------------------------------------------------------
+// Composite layer, [dst-]<op>:<file>  ex: dst-over:basemap.png  over:borders.png
+//   op is over, in, out, atop, xor, plus, multiply or screen, layer OP frame,
+//   dst- swaps the operands to frame OP layer (dst-over puts the layer under the frame).
+bool BlendCfg::addLayer(const char* spec) {
+    BlendLayer layer;
+    const char* opName = spec;
+    if (strncasecmp(opName, "dst-", 4) == 0) {
+        layer.dst = true;
+        opName += 4;
+    }
+    const char* colon = strchr(opName, ':');
+    if (colon != nullptr && colon[1] != '\0') {
+        size_t len = colon - opName;
+        for (unsigned op = 0; op < COMPOSITE_OPS; op++) {
+            if (strlen(COMPOSITE_NAMES[op]) == len && strncasecmp(opName, COMPOSITE_NAMES[op], len) == 0) {
+                layer.op = (CompositeOp)op;
+                layer.path = colon + 1;
+                layers.push_back(layer);
+                return true;
+            }
+        }
+    }
+    cerr << "Bad layer " << spec << ", expect [dst-]<op>:<file>, op over, in, out, atop, xor, plus, multiply or screen" << endl;
+    return false;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Nowrad palette index ranges, see FPalette::getNowradPalette.
+static const BlendClass NOWRAD_CLASSES[] = {
+    { "rain", 1, 12 }, { "freeze", 16, 20 }, { "mixed", 21, 25 }, { "snow", 26, 30 }
+};
+
+// -------------------------------------------------------------------------------------------------
+// Overlay class, <name>[:<first>-<last>][@<decay>]  ex: snow  snow@0.95  hail:40-44
+//   rain, freeze, mixed and snow default to their nowrad index range, all adds those four.
+//   Index 0 is never routed to a class.
+bool BlendCfg::addClass(const char* spec) {
+    BlendClass cls;
+    const char* end = spec + strcspn(spec, ":@");
+    cls.name = lstring(spec, end - spec);
+
+    bool okay = ! cls.name.empty();
+    bool ranged = false;
+    if (*end == ':') {
+        char* endPtr;
+        unsigned first = (unsigned)strtoul(end + 1, &endPtr, 10);
+        unsigned last = (*endPtr == '-') ? (unsigned)strtoul(endPtr + 1, &endPtr, 10) : first;
+        okay = okay && first >= 1 && first <= last && last <= 255;
+        cls.first = (BYTE)first;
+        cls.last = (BYTE)last;
+        end = endPtr;
+        ranged = true;
+    }
+    if (*end == '@') {
+        char* endPtr;
+        cls.decay = strtof(end + 1, &endPtr);
+        okay = okay && endPtr != end + 1 && cls.decay > 0 && cls.decay <= 1;
+        end = endPtr;
+    }
+    okay = okay && *end == '\0';
+
+    if (okay && ! ranged) {
+        okay = false;
+        bool all = strcasecmp(cls.name.c_str(), "all") == 0;
+        for (const BlendClass& nowrad : NOWRAD_CLASSES) {
+            if (all || strcasecmp(cls.name.c_str(), nowrad.name.c_str()) == 0) {
+                BlendClass known = nowrad;
+                known.decay = cls.decay;
+                classes.push_back(known);
+                okay = true;
+            }
+        }
+    } else if (okay) {
+        classes.push_back(cls);
+    }
+    if (! okay) {
+        cerr << "Bad class " << spec << ", expect <name>[:<first>-<last>][@<decay>], name rain, freeze, mixed, snow or all without a range" << endl;
+    }
+    return okay;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Frame to overlay index mapping, defaults to nowrad to gray.
 const Mapping&   BlendCfg::getMapping() const {
     if (! mapping.isReady) {
-
+        return FPalette::getNowradToGrayMapping();
     }
     return mapping;
 }
 
 // -------------------------------------------------------------------------------------------------
+// Overlay palette, defaults to nowrad gray.
 const FPalette&   BlendCfg::getOverlayPalette() const {
-
     if (overlayPalette.empty()) {
-        MapList mapList;
-        StringList keys;
-        fields.at("overlay-palette")->toMapList(mapList, keys);
-        std::cout << "keys=" << keys.size() << std::endl;
+        return FPalette::getNowradGrayPalette();
     }
-
     return overlayPalette;
 }
+
+// -------------------------------------------------------------------------------------------------
+// Overlay palette color, "#rrggbb" or "#rrggbbaa".
+static bool ParseColor(const JsonBase* json, FColor& color) {
+    if (json->mJtype != JsonBase::Value)
+        return false;
+    const JsonValue& value = *(const JsonValue*)json;
+    if (value.empty() || value[0] != '#')
+        return false;
+    char* endPtr;
+    unsigned long rgba = strtoul(value.c_str() + 1, &endPtr, 16);
+    size_t digits = endPtr - (value.c_str() + 1);
+    if (*endPtr != '\0' || (digits != 6 && digits != 8))
+        return false;
+    if (digits == 6) {
+        rgba = (rgba << 8) | 0xff;
+    }
+    color = FColor((BYTE)(rgba >> 24), (BYTE)(rgba >> 16), (BYTE)(rgba >> 8), (BYTE)rgba);
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Config "overlay-palette": [ color, ... ], overlay index to color, see ParseColor.
+bool BlendCfg::setOverlayPalette(const JsonBase* json) {
+    FPalette palette;
+    bool okay = (json->mJtype == JsonBase::Array);
+    if (okay) {
+        for (const JsonBase* item : *(const JsonArray*)json) {
+            FColor color;
+            if (palette.size() == 256 || ! ParseColor(item, color)) {
+                okay = false;
+                break;
+            }
+            palette.hasTransparency = palette.hasTransparency || color.rgbReserved != 0xff;
+            palette.push_back(color);
+        }
+    }
+    if (okay && ! palette.empty()) {
+        overlayPalette = palette;
+    } else {
+        cerr << "Bad overlay-palette, expect up to 256 colors \"#rrggbb[aa]\"" << endl;
+    }
+    return okay;
+}
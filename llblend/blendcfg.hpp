@@ -43,6 +43,32 @@
 #include <sys/stat.h>
 
 #include "fpalette.hpp"
+#include "fimage.hpp"
+
+#include <memory>
+#include <vector>
+
+// Overlay which accumulates mapped frames and is blended over the following frames.
+enum OverlayMode { OVERLAY_NONE, OVERLAY_P32, OVERLAY_LAZY, OVERLAY_TILED, OVERLAY_PREMUL, OVERLAY_A16, OVERLAY_PLANAR, OVERLAY_INDEX };
+
+// How frames are blended over time, over uses the decaying overlay, see FTemporal.
+enum TemporalMode { TEMPORAL_OVER, TEMPORAL_MAX, TEMPORAL_MEAN, TEMPORAL_LAST, TEMPORAL_HOLD };
+
+// Image composited onto every output frame, ex: basemap under and borders over the blend.
+struct BlendLayer {
+    lstring path;
+    CompositeOp op = COMPOSITE_OVER;
+    bool dst = false;                   // dst-<op>, frame OP layer instead of layer OP frame
+    std::shared_ptr<FImage> imgP32;     // Loaded by BlendFUtil::LoadLayers
+};
+
+// Precipitation class with its own overlay, frame indices first..last are routed to it, see FClasses.
+struct BlendClass {
+    lstring name;
+    BYTE first = 1;
+    BYTE last = 255;
+    float decay = 0;                    // Overlay alpha decay per frame, 0 uses BlendCfg::decay
+};
 
 class BlendCfg {
 public:
@@ -57,8 +83,29 @@ public:
     FPalette overlayPalette;
     Mapping mapping;
 
+    float decay = 0.99f;        // Overlay alpha decay per frame, 0..1
+    OverlayMode overlayMode = OVERLAY_NONE;
+    TemporalMode temporalMode = TEMPORAL_OVER;
+    unsigned holdIndex = 6;     // Hold mode, pixel index at or above is held (nowrad yellow)
+    unsigned holdFrames = 12;   // Hold mode, frames to hold
+    std::vector<BlendLayer> layers;     // Composited in order onto output frames
+    bool linearLight = false;   // Blend over mixes linear light instead of sRGB bytes
+    std::vector<BlendClass> classes;    // Overlay per class, each saved as its own output
+
     const Mapping&  getMapping() const;
     const FPalette&  getOverlayPalette() const;
+
+    bool getNumber(const char* key, float& value) const;
+    void setDecay(float percent);
+    bool setOverlayMode(const char* name);
+    bool setTemporalMode(const char* name);
+    bool setHold(const char* value);
+    bool addLayer(const char* spec);
+    bool setGamma(const char* name);
+    bool addClass(const char* spec);
+    bool setOverlayPalette(const JsonBase* json);
+
+    static const char* toString(CompositeOp op);
 };
 
 typedef  std::shared_ptr<BlendCfg>  SharedCfg;
@@ -45,6 +45,12 @@
 #include "fileutil.hpp"
 #include "commands.hpp"
 #include "directory.hpp"
+#include "fkernel.hpp"
+#include "fthreadpool.hpp"
+#include "ftemporal.hpp"
+#include "fmapfile.hpp"
+#include "fpng.hpp"
+#include "fpack.hpp"
 
 #include <assert.h>
 #include <ctype.h>
@@ -62,77 +68,83 @@
 #include <sstream>
 #include <vector>
 #include <memory>   // unique_ptr
+#include <chrono>
 
 
 bool BlendFUtil::initDone = false;
+bool BlendFUtil::useSpans = true;
+bool BlendFUtil::fastPng = true;
 
 // -------------------------------------------------------------------------------------------------
-unsigned DLL_CALLCONV
-myReadProc(void* buffer, unsigned size, unsigned count, fi_handle handle) {
-    return (unsigned)fread(buffer, size, count, (FILE*)handle);
-}
-
-unsigned DLL_CALLCONV
-myWriteProc(void* buffer, unsigned size, unsigned count, fi_handle handle) {
-    return (unsigned)fwrite(buffer, size, count, (FILE*)handle);
-}
-
-int DLL_CALLCONV
-mySeekProc(fi_handle handle, long offset, int origin) {
-    return fseek((FILE*)handle, offset, origin);
-}
-
-long DLL_CALLCONV
-myTellProc(fi_handle handle) {
-    return ftell((FILE*)handle);
-}
-
-// -------------------------------------------------------------------------------------------------
+// Decode from the file mapped into memory, FreeImage reads the mapping in place.
+// File handle is closed before decoding, see FMapFile.
+// 8bit palette png frames are decoded by FPng, everything else by FreeImage.
 FImage& BlendFUtil::LoadImage(FImage& img, const char* fullname) {
-    FILE* file = fopen(fullname, "rb");
+    if (FPack::Load(fullname, img)) {
+        return img;
+    }
+
+    FMapFile file(fullname);
 
-    if (file != NULL) {
+    if (file.Valid()) {
         BlendFUtil::init();
 
-        FreeImageIO io;
-        io.read_proc = myReadProc;
-        io.write_proc = myWriteProc;
-        io.seek_proc = mySeekProc;
-        io.tell_proc = myTellProc;
+        FPalette palette;
+        if (fastPng && FPng::DecodeI8(file.Data(), file.Size(), img, palette)) {
+            return img;
+        }
 
-        // find the buffer format
-        FREE_IMAGE_FORMAT fif = FreeImage_GetFileTypeFromHandle(&io, (fi_handle)file, 0);
+        FIMEMORY* stream = FreeImage_OpenMemory((BYTE*)file.Data(), (DWORD)file.Size());
 
-        const char* fmtStr = FreeImage_GetFIFDescription(fif);
-        // std::cout << "File format=" << fmtStr << std::endl;
+        // find the buffer format
+        FREE_IMAGE_FORMAT fif = FreeImage_GetFileTypeFromMemory(stream, 0);
 
         if (fif != FIF_UNKNOWN) {
-            // load from the file handle
-            img.LoadFromHandle(fif, &io, (fi_handle)file, 0);
+            img.LoadFromMemory(fif, stream, 0);
         } else {
             std::cerr << "Failed to load " << fullname << std::endl;
         }
+        FreeImage_CloseMemory(stream);
+    } else {
+        std::cerr << "Failed to open " << fullname << std::endl;
     }
     return img;
 }
 
 // -------------------------------------------------------------------------------------------------
-bool BlendFUtil::saveTo(const FImage& out, const char* toName) {
+bool BlendFUtil::saveTo(const FImage& out, const char* toName, bool report) {
     bool okay = false;
 
     // Get output format from the file name or file extension
     FREE_IMAGE_FORMAT out_fif = FreeImage_GetFIFFromFilename(toName);
 
-    if (out_fif != FIF_UNKNOWN) {
-        if ((okay = FreeImage_Save(out_fif, out.imgPtr, toName, 0)))
-            std::cout << "Saved to " << toName << std::endl;
-        else
-            std::cerr << "Saved FAILED to " << toName << std::endl;
+    if (out_fif == FIF_PNG && ! FPng::useFreeImage && (out.GetBitsPerPixel() == 32 || out.GetBitsPerPixel() == 8)) {
+        okay = FPng::Save(out, toName);
+        if (report) {
+            reportSave(okay, toName);
+        }
+    } else if (out_fif != FIF_UNKNOWN) {
+        int flags = 0;
+        if (out_fif == FIF_PNG && FPng::level >= 0) {
+            flags = (FPng::level == 0) ? PNG_Z_NO_COMPRESSION : FPng::level;
+        }
+        okay = FreeImage_Save(out_fif, out.imgPtr, toName, flags);
+        if (report) {
+            reportSave(okay, toName);
+        }
     }
 
     return okay;
 }
 
+// -------------------------------------------------------------------------------------------------
+void BlendFUtil::reportSave(bool okay, const char* toName) {
+    if (okay)
+        std::cout << "Saved to " << toName << std::endl;
+    else
+        std::cerr << "Saved FAILED to " << toName << std::endl;
+}
+
 // -------------------------------------------------------------------------------------------------
 // Index paletized image mapping from src palette to dst palette.
 unsigned BlendFUtil::BestMapping(
@@ -162,6 +174,60 @@ unsigned BlendFUtil::BestMapping(
     return 0;
 }
 
+// -------------------------------------------------------------------------------------------------
+// Load the config composite layers once, converted to 32bit.
+bool BlendFUtil::LoadLayers(BlendCfg& cfg) {
+    bool okay = true;
+    for (BlendLayer& layer : cfg.layers) {
+        FImage img;
+        LoadImage(img, layer.path);
+        if (img.Valid()) {
+            layer.imgP32.reset(new FImage(FreeImage_ConvertTo32Bits(img.imgPtr)));
+        } else {
+            std::cerr << "Layer " << layer.path << " failed to load" << std::endl;
+            okay = false;
+        }
+    }
+    return okay;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Composite the config layers onto the output in order, layer OP out, or out OP layer for dst layers.
+// Outside a smaller layer the layer is clear, which only changes the output for in, out and dst-atop.
+FImage& BlendFUtil::CompositeLayers(const BlendCfg& cfg, FImage& outImgP32) {
+    unsigned width = outImgP32.GetWidth();
+    unsigned height = outImgP32.GetHeight();
+
+    FThreadPool::get().forBands(height, width * 4, [&](unsigned y0, unsigned y1) {
+        for (unsigned y = y0; y < y1; y++) {
+            FColor* out = (FColor*)outImgP32.ScanLine(y);
+            for (const BlendLayer& layer : cfg.layers) {
+                if (layer.imgP32 == nullptr)
+                    continue;
+                FKernel::CompositeRowFn compositeRow = FKernel::compositeRow[layer.op];
+                const FImage& layerP32 = *layer.imgP32;
+                unsigned widthLayer = (y < layerP32.GetHeight()) ? min(width, layerP32.GetWidth()) : 0;
+                if (widthLayer != 0) {
+                    const FColor* top = (const FColor*)layerP32.ReadScanLine(y);
+                    if (layer.dst) {
+                        compositeRow(out, top, out, widthLayer);
+                    } else {
+                        compositeRow(top, out, out, widthLayer);
+                    }
+                }
+
+                bool clearChanges = (layer.op == COMPOSITE_IN)
+                    || (layer.dst ? layer.op == COMPOSITE_ATOP : layer.op == COMPOSITE_OUT);
+                if (clearChanges && widthLayer < width) {
+                    std::fill(out + widthLayer, out + width, FColor(0, 0, 0, 0));
+                }
+            }
+        }
+    });
+
+    return outImgP32;
+}
+
 // -------------------------------------------------------------------------------------------------
 // Truecolor 32bit blend,  top is blended over bottom.
 FImage& BlendFUtil::BlendP32(const FImage& topImgP32, FImage& botImgP32) {
@@ -188,22 +254,157 @@ FImage& BlendFUtil::BlendP32(const FImage& topImgP32, FImage& botImgP32) {
     unsigned height = min(heightTop, heightBot);
     unsigned width = min(widthTop, widthBot);
 
-    for (unsigned y = 0; y < height; y++) {
-        const FColor* top_argb = (const FColor*)topImgP32.ReadScanLine(y);
-        FColor* bot_argb = (FColor*)botImgP32.ScanLine(y);
+    FThreadPool::get().forBands(height, width * 4, [&](unsigned y0, unsigned y1) {
+        for (unsigned y = y0; y < y1; y++) {
+            const FColor* top_argb = (const FColor*)topImgP32.ReadScanLine(y);
+            FColor* bot_argb = (FColor*)botImgP32.ScanLine(y);
+            FKernel::blendOverRow(top_argb, bot_argb, width);
+        }
+    });
 
-        for (unsigned x = 0; x < width; x++) {
-            FColor& botColor = *bot_argb++;
-            top_argb[x].blendOver(botColor);
+    return botImgP32;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Fill row with 32bit color, 16 pixels per copy.
+static void FillRow(uint32_t* row, uint32_t color, unsigned width) {
+    uint32_t block[16];
+    std::fill(block, block + 16, color);
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        memcpy(row + x, block, sizeof(block));
+    }
+    for (; x < width; x++) {
+        row[x] = color;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// Expand 8bit row pixels [x0, x1) through lut into out row.
+// Clear (index 0) runs from the image spans are filled with lut[0] instead of expanded.
+// Spans are built by the caller before bands share them, null expands every pixel.
+void BlendFUtil::ExpandI8Row(const FColor* lut, const FImage& imgI8, const FSpans* spans, unsigned y, FColor* out, unsigned x0, unsigned x1) {
+    const BYTE* idx = imgI8.ReadScanLine(y);
+    if (spans == nullptr) {
+        FKernel::expandBlendRow(lut, idx + x0, nullptr, out + x0, x1 - x0);
+        return;
+    }
+
+    uint32_t clearColor;
+    memcpy(&clearColor, &lut[spans->clearIdx], sizeof(clearColor));
+    uint32_t* outBits = (uint32_t*)out;
+    unsigned x = x0;
+    for (const FSpan* span = spans->begin(y); span != spans->end(y) && span->x < x1; span++) {
+        unsigned spanEnd = min(span->x + span->len, x1);
+        if (spanEnd <= x)
+            continue;
+        unsigned spanX = max(span->x, x);
+        FillRow(outBits + x, clearColor, spanX - x);
+        FKernel::expandBlendRow(lut, idx + spanX, nullptr, out + spanX, spanEnd - spanX);
+        x = spanEnd;
+    }
+    FillRow(outBits + x, clearColor, x1 - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Single pass 8bit palette expand and 32bit blend, top is blended over expanded bottom.
+//   out = topImgP32 over botLut[botImgI8]
+// Replaces ConvertTo32Bits + BlendP32, output image is supplied (reused) by caller.
+FImage& BlendFUtil::ExpandBlendI8_P32(const FColor* botLut, const FImage& botImgI8, const FImage* topImgP32, FImage& outImgP32) {
+    unsigned widthBot = botImgI8.GetWidth();
+    unsigned heightBot = botImgI8.GetHeight();
+    unsigned widthOut = outImgP32.GetWidth();
+    unsigned heightOut = outImgP32.GetHeight();
+    unsigned widthTop = 0;
+    unsigned heightTop = 0;
+
+    if (topImgP32 != nullptr) {
+        if (topImgP32->GetBitsPerPixel() != 32) {
+            std::cerr << "Blend - Top image not 32bit" << std::endl;
+            topImgP32 = nullptr;
+        } else {
+            widthTop = topImgP32->GetWidth();
+            heightTop = topImgP32->GetHeight();
         }
     }
 
-    return botImgP32;
+    unsigned height = min(heightBot, heightOut);
+    unsigned width = min(widthBot, widthOut);
+    unsigned widthBlend = min(width, widthTop);
+
+    const FSpans* botSpans = useSpans ? &botImgI8.Spans() : nullptr;
+
+    FThreadPool::get().forBands(height, width * 4, [&](unsigned y0, unsigned y1) {
+        for (unsigned y = y0; y < y1; y++) {
+            const BYTE* bot = botImgI8.ReadScanLine(y);
+            FColor* out = (FColor*)outImgP32.ScanLine(y);
+            if (y < heightTop) {
+                const FColor* top = (const FColor*)topImgP32->ReadScanLine(y);
+                FKernel::expandBlendRow(botLut, bot, top, out, widthBlend);
+                ExpandI8Row(botLut, botImgI8, botSpans, y, out, widthBlend, width);
+            } else {
+                ExpandI8Row(botLut, botImgI8, botSpans, y, out, 0, width);
+            }
+        }
+    });
+
+    return outImgP32;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Single pass top alpha decay, 8bit palette expand and 32bit blend.
+//   top.alpha *= topDecay
+//   out = topImgP32 over botLut[botImgI8]
+// Replaces AdjustAlphaP32 + ExpandBlendI8_P32, so the overlay (top) is streamed once per frame.
+FImage& BlendFUtil::DecayExpandBlendI8_P32(const FColor* botLut, const FImage& botImgI8, FImage& topImgP32, float topDecay, FImage& outImgP32) {
+    if (topImgP32.GetBitsPerPixel() != 32) {
+        std::cerr << "Blend - Top image not 32bit" << std::endl;
+        return ExpandBlendI8_P32(botLut, botImgI8, nullptr, outImgP32);
+    }
+
+    unsigned scale = (unsigned)(256 * topDecay);
+    unsigned widthTop = topImgP32.GetWidth();
+    unsigned heightTop = topImgP32.GetHeight();
+    unsigned height = min(botImgI8.GetHeight(), outImgP32.GetHeight());
+    unsigned width = min(botImgI8.GetWidth(), outImgP32.GetWidth());
+    unsigned widthBlend = min(width, widthTop);
+
+    const FSpans* botSpans = useSpans ? &botImgI8.Spans() : nullptr;
+
+    FThreadPool::get().forBands(max(height, heightTop), max(width, widthTop) * 4, [&](unsigned y0, unsigned y1) {
+        for (unsigned y = y0; y < y1; y++) {
+            FColor* top = (y < heightTop) ? (FColor*)topImgP32.ScanLine(y) : nullptr;
+            if (y >= height) {
+                FKernel::decayRow(top, scale, widthTop);
+                continue;
+            }
+
+            const BYTE* bot = botImgI8.ReadScanLine(y);
+            FColor* out = (FColor*)outImgP32.ScanLine(y);
+            if (top != nullptr) {
+                FKernel::decayExpandBlendRow(botLut, bot, top, scale, out, widthBlend);
+                FKernel::decayRow(top + widthBlend, scale, widthTop - widthBlend);
+                ExpandI8Row(botLut, botImgI8, botSpans, y, out, widthBlend, width);
+            } else {
+                ExpandI8Row(botLut, botImgI8, botSpans, y, out, 0, width);
+            }
+        }
+    });
+
+    return outImgP32;
 }
 
 // -------------------------------------------------------------------------------------------------
 // Index 8bit palette blended over 32bit bottom.
 FImage& BlendFUtil::BlendI8_P32(const FPalette& topPalette, const FImage& topImgI8, FImage& botImgP32) {
+    FColor topLut[256];
+    topPalette.toTable(topLut);
+    return BlendLutI8_P32(topLut, topImgI8, botImgP32);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Index 8bit image blended over 32bit bottom, top colors from 256 entry lookup table.
+FImage& BlendFUtil::BlendLutI8_P32(const FColor* topLut, const FImage& topImgI8, FImage& botImgP32) {
     unsigned widthTop = topImgI8.GetWidth();
     unsigned heightTop = topImgI8.GetHeight();
     unsigned widthBot = botImgP32.GetWidth();
@@ -212,14 +413,22 @@ FImage& BlendFUtil::BlendI8_P32(const FPalette& topPalette, const FImage& topImg
     unsigned height = min(heightTop, heightBot);
     unsigned width = min(widthTop, widthBot);
 
-    for (unsigned y = 0; y < height; y++) {
-        const BYTE* top = topImgI8.ReadScanLine(y);
-        RGBQUAD* bot = (RGBQUAD*)botImgP32.ScanLine( y);
-        for (unsigned x = 0; x < width; x++) {
-            const FColor& topColor = topPalette[top[x]];
-            topColor.blendOver(bot[x]);
+    // Transparent index 0 runs are skipped, leaving bottom unchanged.
+    const FSpans* spans = (useSpans && topLut[0].rgbReserved == 0) ? &topImgI8.Spans() : nullptr;
+
+    FThreadPool::get().forBands(height, width * 4, [&](unsigned y0, unsigned y1) {
+        for (unsigned y = y0; y < y1; y++) {
+            const BYTE* top = topImgI8.ReadScanLine(y);
+            FColor* bot = (FColor*)botImgP32.ScanLine(y);
+            if (spans != nullptr) {
+                for (const FSpan* span = spans->begin(y); span != spans->end(y) && span->x < width; span++) {
+                    FKernel::lutBlendOverRow(topLut, top + span->x, bot + span->x, min(span->len, width - span->x));
+                }
+            } else {
+                FKernel::lutBlendOverRow(topLut, top, bot, width);
+            }
         }
-    }
+    });
 
     return botImgP32;
 }
@@ -235,17 +444,69 @@ FImage& BlendFUtil::MaximumI8(const FImage& inImgI8, FImage& outImgI8) {
     unsigned height    = min(heightIn, heightOut);
     unsigned width     = min(widthIn, widthOut);
 
-    for (unsigned y = 0; y < height; y++) {
-        const BYTE* in = inImgI8.ReadScanLine(y);
-        BYTE* out = outImgI8.ScanLine(y);
-        for (unsigned x = 0; x < width; x++) {
-            out[x] = max(in[x], out[x]);   // Output is maximum pixel index.
+    // Index 0 runs can not raise the output and are skipped.
+    const FSpans* spans = useSpans ? &inImgI8.Spans() : nullptr;
+    outImgI8.ClearSpans();
+
+    FThreadPool::get().forBands(height, width, [&](unsigned y0, unsigned y1) {
+        for (unsigned y = y0; y < y1; y++) {
+            const BYTE* in = inImgI8.ReadScanLine(y);
+            BYTE* out = outImgI8.ScanLine(y);
+            if (spans != nullptr) {
+                for (const FSpan* span = spans->begin(y); span != spans->end(y) && span->x < width; span++) {
+                    FKernel::maxRow(in + span->x, out + span->x, min(span->len, width - span->x));
+                }
+            } else {
+                FKernel::maxRow(in, out, width);   // Output is maximum pixel index.
+            }
         }
-    }
+    });
 
     return outImgI8;
 }
 
+// -------------------------------------------------------------------------------------------------
+// Maximum pixel index over all frames,  out = max(frame0, frame1, ...)
+// Each pool worker loads every threadCnt'th frame into its own partial maximum,
+// partials are then merged pairwise in a parallel reduction tree.
+// Output is the partial holding the first frame, so it keeps the first frame palette.
+FImageRef& BlendFUtil::MaximumFrames(const std::vector<lstring>& paths, unsigned threadCnt, FImageRef& outImgI8Ref) {
+    init();
+    threadCnt = max(1u, min(threadCnt, (unsigned)paths.size()));
+    std::vector<FImageRef> partials(threadCnt);
+
+    FThreadPool& pool = FThreadPool::get();
+    pool.forEach(threadCnt, [&](unsigned worker) {
+        FImageRef& partial = partials[worker];
+        for (size_t idx = worker; idx < paths.size() && ! Command::abortFlag; idx += threadCnt) {
+            FImageRef imgI8Ref(new FImage());
+            if (! LoadImage(*imgI8Ref, paths[idx]).Valid() || imgI8Ref->GetBitsPerPixel() != 8) {
+                std::cerr << "Maximum - Skip, not 8bit " << paths[idx] << std::endl;
+            } else if (partial == nullptr) {
+                partial.swap(imgI8Ref);
+            } else {
+                MaximumI8(*imgI8Ref, *partial);
+            }
+        }
+    });
+
+    for (unsigned step = 1; step < threadCnt; step *= 2) {
+        pool.forEach((threadCnt - step + step * 2 - 1) / (step * 2), [&](unsigned pair) {
+            FImageRef& dst = partials[pair * step * 2];
+            FImageRef& src = partials[pair * step * 2 + step];
+            if (dst == nullptr) {
+                dst.swap(src);
+            } else if (src != nullptr) {
+                MaximumI8(*src, *dst);
+                src.reset();
+            }
+        });
+    }
+
+    outImgI8Ref.swap(partials[0]);
+    return outImgI8Ref;
+}
+
 // -------------------------------------------------------------------------------------------------
 void BlendFUtil::Dump(const char* fullname) {
     FImage img;
@@ -257,66 +518,263 @@ void BlendFUtil::Dump(const char* fullname) {
 }
 
 // -------------------------------------------------------------------------------------------------
-FImageRef& BlendFUtil::Blend(const char* fullname, const BlendCfg& cfg, FImageRef& grayImgP32Ref) {
+// Time 8bit index kernels with and without skipping transparent spans.
+// Spans are built once per frame and shared by the kernels, build time is reported on its own.
+void BlendFUtil::Bench(const char* fullname, const BlendCfg& cfg) {
+    const unsigned LOOPS = 50;
     FImage imgI8;
-    if (LoadImage(imgI8, fullname).Valid()) {
-
-        unsigned bitsPerPixel = imgI8.GetBitsPerPixel();
-        if (bitsPerPixel != 8) {
-            FPrint::printInfo(imgI8, fullname);
-            //    FPrint::printPalette(img);
-            //    FPrint::printHisto(img);
-            std::cerr << fullname << " must by 8 bit per pixel images\n";
-            return grayImgP32Ref;
+    if (! LoadImage(imgI8, fullname).Valid() || imgI8.GetBitsPerPixel() != 8) {
+        std::cerr << "Bench - Failed to load 8bit " << fullname << std::endl;
+        return;
+    }
+
+    unsigned width = imgI8.GetWidth();
+    unsigned height = imgI8.GetHeight();
+    FPalette imgPalette;
+    imgI8.getPalette(imgPalette);
+    FColor imgLut[256];
+    imgPalette.toTable(imgLut);
+    FColor overlayLut[256];
+    OverlayTable(cfg, imgPalette, overlayLut);
+
+    FImageRef outImgP32(FImage::Allocate(width, height, 32));
+    FImageRef maxImgI8(FImage::Allocate(width, height, 8));
+    maxImgI8->FillImage(FPalette::BLACK);
+
+    auto buildT = std::chrono::steady_clock::now();
+    for (unsigned loop = 0; loop < LOOPS; loop++) {
+        imgI8.ClearSpans();
+        imgI8.Spans();
+    }
+    std::chrono::duration<double, std::milli> buildMs = std::chrono::steady_clock::now() - buildT;
+
+    std::ios_base::fmtflags saveFlags = std::cout.flags();
+    std::streamsize savePrecision = std::cout.precision();
+    const FSpans& spans = imgI8.Spans();
+    std::cout << fullname << " " << width << "x" << height
+        << " spans=" << spans.SpanCount()
+        << " opaque=" << std::fixed << std::setprecision(1) << (100.0 * spans.PixelCount() / (width * height)) << "%"
+        << " build " << std::setprecision(3) << (buildMs.count() / LOOPS) << " ms\n";
+
+    bool saveUseSpans = useSpans;
+    for (unsigned kernel = 0; kernel < 3; kernel++) {
+        static const char* const NAMES[] = { "ExpandBlendI8_P32", "BlendLutI8_P32", "MaximumI8" };
+        double msec[2];
+        for (unsigned pass = 0; pass < 2; pass++) {
+            useSpans = (pass == 1);
+            auto startT = std::chrono::steady_clock::now();
+            for (unsigned loop = 0; loop < LOOPS; loop++) {
+                switch (kernel) {
+                case 0:
+                    ExpandBlendI8_P32(imgLut, imgI8, nullptr, outImgP32);
+                    break;
+                case 1:
+                    BlendLutI8_P32(overlayLut, imgI8, outImgP32);
+                    break;
+                case 2:
+                    MaximumI8(imgI8, maxImgI8);
+                    break;
+                }
+            }
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startT;
+            msec[pass] = elapsed.count() / LOOPS;
         }
-        unsigned width = imgI8.GetWidth();
-        unsigned height = imgI8.GetHeight();
-        unsigned colors = imgI8.GetColorsUsed();
-
-        FImage imgP32 = imgI8.ConvertTo32Bits();
-        if (grayImgP32Ref != nullptr) {
-            grayImgP32Ref->AdjustAlphaP32(0.99f);
-            BlendFUtil::BlendP32(*grayImgP32Ref, imgP32);
+        std::cout << "  " << std::left << std::setw(20) << NAMES[kernel] << std::right
+            << " all " << std::setprecision(3) << std::setw(8) << msec[0] << " ms"
+            << "  spans " << std::setw(8) << msec[1] << " ms"
+            << "  speedup " << std::setprecision(2) << (msec[0] / msec[1]) << "x\n";
+    }
+    useSpans = saveUseSpans;
+    std::cout.flags(saveFlags);
+    std::cout.precision(savePrecision);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Frame index to overlay color table, frame index mapped by cfg mapping into overlay palette.
+// Same as ApplyPaletteIndexMapping + setPalette(overlayPalette).
+void BlendFUtil::OverlayTable(const BlendCfg& cfg, const FPalette& imgPalette, FColor overlayLut[256]) {
+    const Mapping& mapping = cfg.getMapping();
+    const FPalette& overlayPalette = cfg.getOverlayPalette();
+
+    BYTE overlayIdx[256];
+    for (unsigned idx = 0; idx < 256; idx++) {
+        overlayIdx[idx] = (BYTE)idx;
+    }
+    for (unsigned idx = (unsigned)min(imgPalette.size(), (size_t)256); idx-- > 0; ) {
+        overlayIdx[mapping.from[idx]] = mapping.to[idx];     // First match wins
+    }
+
+    for (unsigned idx = 0; idx < 256; idx++) {
+        overlayLut[idx] = (overlayIdx[idx] < overlayPalette.size()) ? overlayPalette[overlayIdx[idx]] : FPalette::TRANSPARENT;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// Blend and save frames [first, last), with the overlay rebuilt from the warm frames before first
+// (outputs of warm frames are not saved). A copy of the overlay entering first is returned in carryInRef,
+// so chunks can run in parallel and be checked against their predecessor, see FOverlay::Same.
+// Returns false if any frame of [first, last) failed to load or save.
+bool BlendFUtil::BlendChunk(const std::vector<lstring>& paths, size_t first, size_t last, size_t warm,
+    const BlendCfg& cfg, FOverlayRef& overlayRef, FOverlayRef& carryInRef) {
+    bool okay = true;
+    FImageRef outImgRef;
+    for (size_t idx = (first > warm) ? first - warm : 0; idx < last && ! Command::abortFlag; idx++) {
+        if (idx == first && overlayRef != nullptr) {
+            carryInRef.reset(overlayRef->Clone());
         }
-        lstring fullPath(fullname);
-        lstring outFname;
-        FileUtil::getName(outFname, fullPath);
-        BlendFUtil::saveTo(imgP32, outFname);
-        imgP32.Close();
 
-        FPalette imgPalette;
-        imgI8.getPalette(imgPalette);
+        FImage imgI8;
+        if (! LoadImage(imgI8, paths[idx]).Valid()) {
+            if (idx >= first)
+                okay = false;
+        } else if (BlendFrame(imgI8, paths[idx], cfg, overlayRef, outImgRef) && idx >= first) {
+            lstring outFname;
+            FileUtil::getName(outFname, paths[idx]);
+            okay = BlendFUtil::saveTo(*outImgRef, outFname) && okay;
+        }
+    }
+    return okay;
+}
 
-        /*
-        const FPalette& nowradPalette = FPalette::getNowradPalette();
-        const FPalette& overlayPalette = FPalette::getNowradGrayPalette();
-        const Mapping& nMapping = FPalette::getNowradToGrayMapping();
-        Mapping mapping;
-         BlendFUtil::BestMapping(imgPalette, nowradPalette, nMapping.to, mapping);
-        */
-
-#if 0
-        const Mapping& mapping = cfg.getMapping();
-        const FPalette& overlayPalette = cfg.getOverlayPalette();
-
-        unsigned changed;
-        changed = imgI8.ApplyPaletteIndexMapping(mapping.from, mapping.to, colors, false);
-        imgI8.setPalette(overlayPalette);
-
-        if (grayImgP32Ref == nullptr) {
-            FImage* imgPtr = FImage::Allocate(width, height, 32, 0xff0000, 0xf00, 0xff);
-            FImageRef imgRef(imgPtr);
-            grayImgP32Ref.swap(imgRef);
-            grayImgP32Ref->FillImage(FPalette::TRANSPARENT);
+// -------------------------------------------------------------------------------------------------
+// True if overlays have the same alpha, and the same color where alpha is not 0.
+// Color of transparent overlay pixels never reaches visible output. Null is an empty overlay.
+bool BlendFUtil::SameOverlay(const FImage* imgP32, const FImage* otherP32) {
+    if (imgP32 == nullptr || otherP32 == nullptr) {
+        const FImage* oneP32 = (imgP32 != nullptr) ? imgP32 : otherP32;
+        if (oneP32 == nullptr)
+            return true;
+        for (unsigned y = 0; y < oneP32->GetHeight(); y++) {
+            const FColor* row = (const FColor*)oneP32->ReadScanLine(y);
+            for (unsigned x = 0; x < oneP32->GetWidth(); x++) {
+                if (row[x].rgbReserved != 0)
+                    return false;
+            }
         }
+        return true;
+    }
+
+    if (imgP32->GetWidth() != otherP32->GetWidth() || imgP32->GetHeight() != otherP32->GetHeight())
+        return false;
+    for (unsigned y = 0; y < imgP32->GetHeight(); y++) {
+        const FColor* row = (const FColor*)imgP32->ReadScanLine(y);
+        const FColor* other = (const FColor*)otherP32->ReadScanLine(y);
+        for (unsigned x = 0; x < imgP32->GetWidth(); x++) {
+            if (row[x].rgbReserved != other[x].rgbReserved
+                || (row[x].rgbReserved != 0 && memcmp(&row[x], &other[x], sizeof(FColor)) != 0))
+                return false;
+        }
+    }
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Blend one loaded frame,  out = overlay over frame,  then frame is blended into the overlay.
+// Frames must be blended in order, returns false if frame is not 8bit.
+bool BlendFUtil::BlendFrame(const FImage& imgI8, const char* fullname, const BlendCfg& cfg, FOverlayRef& overlayRef, FImageRef& outImgP32Ref) {
+    unsigned bitsPerPixel = imgI8.GetBitsPerPixel();
+    if (bitsPerPixel != 8) {
+        FPrint::printInfo(imgI8, fullname);
+        //    FPrint::printPalette(img);
+        //    FPrint::printHisto(img);
+        std::cerr << fullname << " must by 8 bit per pixel images\n";
+        return false;
+    }
+    unsigned width = imgI8.GetWidth();
+    unsigned height = imgI8.GetHeight();
+
+    FPalette imgPalette;
+    imgI8.getPalette(imgPalette);
 
-        BlendI8_P32(overlayPalette, imgI8, grayImgP32Ref);
-#endif
+    // Output image is reused across frames of the same size.
+    if (outImgP32Ref == nullptr || outImgP32Ref->GetWidth() != width || outImgP32Ref->GetHeight() != height) {
+        FImageRef imgRef(FImage::Allocate(width, height, 32));
+        outImgP32Ref.swap(imgRef);
+    }
 
-        imgI8.Close();
+    // Decay overlay, expand palette and blend overlay in one pass,
+    // replaces AdjustAlphaP32 + ConvertTo32Bits + BlendP32.
+    FColor imgLut[256];
+    imgPalette.toTable(imgLut);
+    if (overlayRef == nullptr && cfg.temporalMode != TEMPORAL_OVER) {
+        overlayRef.reset(FTemporal::Create(cfg, width, height));    // Blended in by Composite
+    }
+    if (overlayRef != nullptr) {
+        overlayRef->Composite(imgLut, imgI8, *outImgP32Ref);
+    } else {
+        BlendFUtil::ExpandBlendI8_P32(imgLut, imgI8, nullptr, *outImgP32Ref);
+    }
+    if (! cfg.layers.empty()) {
+        CompositeLayers(cfg, *outImgP32Ref);
+        if (overlayRef != nullptr) {
+            overlayRef->OutputChanged();    // Layers wrote over quiet output tiles
+        }
     }
 
-    return grayImgP32Ref;
+    /*
+    const FPalette& nowradPalette = FPalette::getNowradPalette();
+    const FPalette& overlayPalette = FPalette::getNowradGrayPalette();
+    const Mapping& nMapping = FPalette::getNowradToGrayMapping();
+    Mapping mapping;
+     BlendFUtil::BestMapping(imgPalette, nowradPalette, nMapping.to, mapping);
+    */
+
+    // Blend frame into overlay, frame index mapped to overlay palette.
+    // Lookup table replaces ApplyPaletteIndexMapping + setPalette + BlendI8_P32.
+    if (cfg.temporalMode == TEMPORAL_OVER && cfg.overlayMode != OVERLAY_NONE) {
+        FColor overlayLut[256];
+        OverlayTable(cfg, imgPalette, overlayLut);
+
+        if (overlayRef == nullptr) {
+            overlayRef.reset(FTemporal::Create(cfg, width, height));
+        }
+        overlayRef->Update(overlayLut, imgI8);
+    }
+
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Blend frames into the overlay without making output, same overlay as BlendFrame for each frame.
+void BlendFUtil::UpdateFrames(const std::vector<FImageRef>& imgI8Refs, const std::vector<lstring>& names,
+    const BlendCfg& cfg, FOverlayRef& overlayRef) {
+    std::vector<const FImage*> framesI8;
+    std::vector<FColor> overlayLuts;
+    for (size_t idx = 0; idx < imgI8Refs.size(); idx++) {
+        const FImage& imgI8 = *imgI8Refs[idx];
+        if (! imgI8.Valid())
+            continue;
+        if (imgI8.GetBitsPerPixel() != 8) {
+            FPrint::printInfo(imgI8, names[idx]);
+            std::cerr << names[idx] << " must by 8 bit per pixel images\n";
+            continue;
+        }
+
+        // Temporal modes other than over blend the frame colors.
+        FPalette imgPalette;
+        imgI8.getPalette(imgPalette);
+        FColor overlayLut[256];
+        if (cfg.temporalMode == TEMPORAL_OVER) {
+            OverlayTable(cfg, imgPalette, overlayLut);
+        } else {
+            imgPalette.toTable(overlayLut);
+        }
+
+        // First overlay frame starts the overlay and is not decayed.
+        if (overlayRef == nullptr) {
+            overlayRef.reset(FTemporal::Create(cfg, imgI8.GetWidth(), imgI8.GetHeight()));
+            if (cfg.temporalMode == TEMPORAL_OVER) {
+                overlayRef->Update(overlayLut, imgI8);
+                continue;
+            }
+        }
+        framesI8.push_back(&imgI8);
+        overlayLuts.insert(overlayLuts.end(), overlayLut, overlayLut + 256);
+    }
+
+    if (! framesI8.empty()) {
+        overlayRef->UpdateFrames(framesI8, overlayLuts);
+    }
 }
 
 // -------------------------------------------------------------------------------------------------
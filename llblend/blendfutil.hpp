@@ -40,15 +40,19 @@
 #pragma once
 
 #include <iostream>
+#include <vector>
 
 #include "fimage.hpp"
 #include "fpalette.hpp"
 #include "fbrush.hpp"
 #include "blendcfg.hpp"
+#include "fkernel.hpp"
+#include "foverlay.hpp"
 
 class BlendFUtil {
 public:
-    static bool saveTo(const FImage& img, const char* toName);
+    static bool saveTo(const FImage& img, const char* toName, bool report = true);
+    static void reportSave(bool okay, const char* toName);
     static FImage& LoadImage(FImage& img, const char* fullname);
 
     static void FreeImageErrorHandler(FREE_IMAGE_FORMAT imgFmt, const char* message) {
@@ -60,6 +64,8 @@ public:
     }
 
     static bool initDone;
+    static bool useSpans;       // Index kernels skip transparent spans (FImage::Spans)
+    static bool fastPng;        // 8bit palette png frames decoded by FPng, not FreeImage
     static void init() {
         if (! initDone) {
             // Call this ONLY when linking with FreeImage as a static library
@@ -70,6 +76,7 @@ public:
 
             // Print version & copyright infos
             std::cout << FreeImage_GetVersion() << std::endl << FreeImage_GetCopyrightMessage() << std::endl;
+            std::cout << "Blend kernels " << FKernel::toString(FKernel::getIsa()) << std::endl;
 
             initDone = true;
         }
@@ -78,13 +85,27 @@ public:
 
     static void Dump(const char* fullname);
     static void Palette(const char* fullname);
+    static void Bench(const char* fullname, const BlendCfg& cfg);
 
-    static FImageRef& Blend(const char* fullname, const BlendCfg& cfg, FImageRef& grayImgRef );
+    static bool BlendChunk(const std::vector<lstring>& paths, size_t first, size_t last, size_t warm,
+        const BlendCfg& cfg, FOverlayRef& overlayRef, FOverlayRef& carryInRef);
+    static bool SameOverlay(const FImage* imgP32, const FImage* otherP32);
+    static bool BlendFrame(const FImage& imgI8, const char* fullname, const BlendCfg& cfg, FOverlayRef& overlayRef, FImageRef& outImgRef);
+    static void UpdateFrames(const std::vector<FImageRef>& imgI8Refs, const std::vector<lstring>& names, const BlendCfg& cfg, FOverlayRef& overlayRef);
     static FImage& BlendP32(const FImage& topImgP32,  FImage& botImgP32);
+    static void ExpandI8Row(const FColor* lut, const FImage& imgI8, const FSpans* spans, unsigned y, FColor* out, unsigned x0, unsigned x1);
+    static FImage& ExpandBlendI8_P32(const FColor* botLut, const FImage& botImgI8, const FImage* topImgP32, FImage& outImgP32);
+    static FImage& DecayExpandBlendI8_P32(const FColor* botLut, const FImage& botImgI8, FImage& topImgP32, float topDecay, FImage& outImgP32);
     static FImage& BlendI8_P32(const FPalette& topPalette, const FImage& topImgI8,  FImage& botImgP32);
+    static FImage& BlendLutI8_P32(const FColor* topLut, const FImage& topImgI8,  FImage& botImgP32);
 
     static FImage& MaximumI8(const FImage& inImgI8, FImage& outImgI8);       // out = max(in, out)
+    static FImageRef& MaximumFrames(const std::vector<lstring>& paths, unsigned threadCnt, FImageRef& outImgI8Ref);
 
+    static bool LoadLayers(BlendCfg& cfg);
+    static FImage& CompositeLayers(const BlendCfg& cfg, FImage& outImgP32);
+
+    static void OverlayTable(const BlendCfg& cfg, const FPalette& imgPalette, FColor overlayLut[256]);
     static unsigned BestMapping(const FPalette& srcPalette, const FPalette& dstPalette, const BYTE* dstMapping, Mapping& mappings);
 
     static void AdjustAlpha(float percent, const FImage& imgP32);
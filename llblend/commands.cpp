@@ -57,8 +57,49 @@
 // #include "blendfutil.hpp"
 #include "fprint.hpp"
 #include "fileutil.hpp"
+#include "fthreadpool.hpp"
+#include "ftemporal.hpp"
+#include "fwindow.hpp"
+#include "fclasses.hpp"
+#include "fpack.hpp"
+#include "fpng.hpp"
+#include "fpipeline.hpp"
 
 
+//-------------------------------------------------------------------------------------------------
+// Packed frames are filtered by their frame name, as the files they were packed from.
+size_t Command::addPack(const lstring& packPath) {
+    size_t fileCount = 0;
+    StringList framePaths;
+    if (FPack::AddFrames(packPath, framePaths)) {
+        for (const lstring& framePath : framePaths) {
+            fileCount += add(framePath, IS_FILE);
+        }
+    }
+    return fileCount;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Commands which load their frames in end() collect the matching files here.
+size_t Command::addPath(const lstring& fullname, DIR_TYPES dtype, StringList& paths) {
+    size_t fileCount = 0;
+    lstring name;
+    FileUtil::getName(name, fullname);
+
+    if (dtype == IS_FILE && FPack::IsPack(fullname))
+        return addPack(fullname);
+    if (dtype == IS_FILE && ! name.empty()
+        && ! FileUtil::FileMatches(name, excludeFilePatList, false)
+        && FileUtil::FileMatches(name, includeFilePatList, true)) {
+        fileCount++;
+        if (showFile)
+            std::cout << fullname.c_str() << std::endl;
+        paths.push_back(fullname);
+    }
+
+    return fileCount;
+}
+
 //-------------------------------------------------------------------------------------------------
 // Locate matching files which are not in exclude list.
 // Locate pair of files one encrypt with AXX and the native file
@@ -89,6 +130,192 @@ size_t CmdDumpF::add(const lstring& fullname, DIR_TYPES dtype) {
 }
 
 
+//-------------------------------------------------------------------------------------------------
+// Time index kernels on matching files.
+size_t CmdBenchF::add(const lstring& fullname, DIR_TYPES dtype) {
+    size_t fileCount = 0;
+    lstring name;
+    FileUtil::getName(name, fullname);
+
+    if (dtype == IS_FILE && ! name.empty()
+        && ! FileUtil::FileMatches(name, excludeFilePatList, false)
+        && FileUtil::FileMatches(name, includeFilePatList, true)) {
+        fileCount++;
+        BlendFUtil::Bench(fullname, blendCfg);
+    }
+
+    return fileCount;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Collect matching files, frames are reduced in end().
+size_t CmdMaximumF::add(const lstring& fullname, DIR_TYPES dtype) {
+    return addPath(fullname, dtype, paths);
+}
+
+//-------------------------------------------------------------------------------------------------
+bool CmdMaximumF::end() {
+    bool okay = false;
+    std::sort(paths.begin(), paths.end());
+
+    unsigned threadCnt = FThreadPool::getThreads();
+    FImageRef maxImgRef;
+    BlendFUtil::MaximumFrames(paths, threadCnt, maxImgRef);
+    if (maxImgRef != nullptr) {
+        std::cout << "Maximum of " << paths.size() << " frames, threads=" << threadCnt << std::endl;
+        okay = BlendFUtil::saveTo(maxImgRef, outName);
+    }
+    return okay;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Collect matching files, window slides over them in end().
+size_t CmdWindowF::add(const lstring& fullname, DIR_TYPES dtype) {
+    return addPath(fullname, dtype, paths);
+}
+
+//-------------------------------------------------------------------------------------------------
+// Frames are decoded ahead and outputs encoded behind the in order window update.
+// Output keeps the palette of its frame.
+bool CmdWindowF::end() {
+    std::sort(paths.begin(), paths.end());
+
+    FWindow::Stat stat = (blendCfg.temporalMode == TEMPORAL_MEAN) ? FWindow::MEAN : FWindow::MAX;
+    if (blendCfg.temporalMode == TEMPORAL_LAST || blendCfg.temporalMode == TEMPORAL_HOLD) {
+        std::cerr << "Window only has max or mean, using max" << std::endl;
+    }
+    FWindow window(windowFrames, stat);
+    std::cout << "Window " << ((stat == FWindow::MEAN) ? "mean" : "max") << " of " << window.frames << " frames" << std::endl;
+
+    FPipeline pipeline(paths, abortFlag);
+    FPipeline::EncodeFn saveFn = [](const FImage& outImg, const lstring& outFname) {
+        return BlendFUtil::saveTo(outImg, outFname);
+    };
+    size_t idx;
+    FImageRef imgI8Ref;
+    while (pipeline.Next(idx, imgI8Ref)) {
+        FImageRef outImgRef(imgI8Ref->Clone());
+        if (! window.Push(imgI8Ref)) {
+            std::cerr << "Window - Skip " << paths[idx] << std::endl;
+            continue;
+        }
+        window.Output(*outImgRef);
+
+        lstring outFname;
+        FileUtil::getName(outFname, paths[idx]);
+        pipeline.Encode(outImgRef, outFname, saveFn);
+    }
+    return pipeline.Finish();
+}
+
+size_t CmdClassF::add(const lstring& fullname, DIR_TYPES dtype) {
+    return addPath(fullname, dtype, paths);
+}
+
+//-------------------------------------------------------------------------------------------------
+// Frames are decoded ahead and outputs encoded behind the in order class overlay update,
+// each frame is decoded and scanned once for all classes.
+bool CmdClassF::end() {
+    std::sort(paths.begin(), paths.end());
+
+    if (blendCfg.temporalMode != TEMPORAL_OVER || blendCfg.overlayMode != OVERLAY_NONE) {
+        std::cerr << "Class overlays are 32bit decaying overlays, -mode and -overlay are not used" << std::endl;
+    }
+    std::cout << "Classes";
+    for (const BlendClass& cls : blendCfg.classes) {
+        std::cout << " " << cls.name << ":" << (unsigned)cls.first << "-" << (unsigned)cls.last;
+    }
+    std::cout << std::endl;
+
+    FPipeline pipeline(paths, abortFlag);
+    FPipeline::EncodeFn saveFn = [](const FImage& outImg, const lstring& outFname) {
+        return BlendFUtil::saveTo(outImg, outFname);
+    };
+    std::unique_ptr<FClasses> classesRef;
+    size_t idx;
+    FImageRef imgI8Ref;
+    while (pipeline.Next(idx, imgI8Ref)) {
+        const FImage& imgI8 = *imgI8Ref;
+        if (imgI8.GetBitsPerPixel() != 8) {
+            std::cerr << paths[idx] << " must by 8 bit per pixel images\n";
+            continue;
+        }
+
+        FPalette imgPalette;
+        imgI8.getPalette(imgPalette);
+        FColor imgLut[256];
+        imgPalette.toTable(imgLut);
+        if (classesRef == nullptr) {
+            classesRef.reset(new FClasses(blendCfg.classes, blendCfg.decay, imgI8.GetWidth(), imgI8.GetHeight()));
+        }
+
+        lstring name;
+        FileUtil::getName(name, paths[idx]);
+        for (unsigned cls = 0; cls < classesRef->Count(); cls++) {
+            FImageRef outImgRef = pipeline.ReuseImage();
+            if (outImgRef == nullptr) {
+                outImgRef.reset(FImage::Allocate(imgI8.GetWidth(), imgI8.GetHeight(), 32));
+            }
+            classesRef->Composite(cls, imgLut, imgI8, *outImgRef);
+            if (! blendCfg.layers.empty()) {
+                BlendFUtil::CompositeLayers(blendCfg, *outImgRef);
+            }
+            pipeline.Encode(outImgRef, classesRef->classes[cls].name + "_" + name, saveFn);
+        }
+
+        // Class overlays keep the frame colors, as the temporal modes do.
+        classesRef->Update(imgLut, imgI8);
+    }
+    return pipeline.Finish();
+}
+
+//-------------------------------------------------------------------------------------------------
+size_t CmdPackF::add(const lstring& fullname, DIR_TYPES dtype) {
+    return addPath(fullname, dtype, paths);
+}
+
+//-------------------------------------------------------------------------------------------------
+// Frames are decoded ahead and written in order, with the file modification time.
+bool CmdPackF::end() {
+    if (paths.empty()) {
+        std::cerr << "No frames to pack" << std::endl;
+        return false;
+    }
+    std::sort(paths.begin(), paths.end());
+
+    FPack::Writer writer(outName, lz4 ? FPack::CODEC_LZ4 : FPack::CODEC_RAW);
+    if (! writer.Valid()) {
+        std::cerr << "Failed to create " << outName << std::endl;
+        return false;
+    }
+
+    size_t packed = 0;
+    bool okay = true;
+    {
+        FPipeline pipeline(paths, abortFlag);
+        size_t idx;
+        FImageRef imgI8Ref;
+        while (okay && pipeline.Next(idx, imgI8Ref)) {
+            if (imgI8Ref->GetBitsPerPixel() != 8) {
+                std::cerr << paths[idx] << " must by 8 bit per pixel images\n";
+                continue;
+            }
+
+            lstring name;
+            FileUtil::getName(name, paths[idx]);
+            struct stat info;
+            int64_t time = (stat(paths[idx], &info) == 0) ? (int64_t)info.st_mtime : 0;
+            okay = writer.Add(name, time, *imgI8Ref);
+            packed++;
+        }
+    }   // Waits on decodes left by abort or error
+
+    okay = writer.Close() && okay;
+    BlendFUtil::reportSave(okay, outName);
+    std::cout << "Packed " << packed << " frames" << std::endl;
+    return okay;
+}
+
 //-------------------------------------------------------------------------------------------------
 bool CmdBlendF::begin(StringList& fileDirList) {
 
@@ -97,37 +324,115 @@ bool CmdBlendF::begin(StringList& fileDirList) {
         // imageRefPalette  = new Image();
         // imageRefPalette->type(PaletteType);
     }
-    overlayImgRef = nullptr;
+    overlayRef = nullptr;
     return fileDirList.size() > 0;
 }
 
 
 //-------------------------------------------------------------------------------------------------
-// Locate matching files which are not in exclude list.
-// Locate pair of files one encrypt with AXX and the native file
+// Collect matching files, frames are blended in end().
 size_t CmdBlendF::add(const lstring& fullname, DIR_TYPES dtype) {
-    size_t fileCount = 0;
-    lstring name;
-    FileUtil::getName(name, fullname);
+    return addPath(fullname, dtype, paths);
+}
 
-    if (dtype == IS_FILE && ! name.empty()
-        && ! FileUtil::FileMatches(name, excludeFilePatList, false)
-        && FileUtil::FileMatches(name, includeFilePatList, true)) {
-        fileCount++;
+//-------------------------------------------------------------------------------------------------
+// Split sorted frames into chunks blended in parallel, then fix up chunks in order.
+// Each chunk first replays WARM_DECAYS overlay decay lifetimes of prior frames, which normally
+// rebuilds the same overlay its predecessor ends with. A chunk whose carried in overlay differs
+// from the exact end of its predecessor is blended again from that overlay, so the output
+// is the same as the serial blend.
+bool CmdBlendF::endChunks() {
+    const unsigned WARM_DECAYS = 2;
+    bool okay = false;
+    unsigned decayFrames = FTemporal::DecayFrames(blendCfg);
+    if (decayFrames == FOverlay::NEVER) {
+        std::cerr << "Chunks need overlay decay < 1 or -mode=hold, blending in series" << std::endl;
+        chunkCnt = 0;
+        return end();
+    }
 
-        struct stat info;
-        if (stat(fullname, &info) == 0 && FileUtil::isWriteableFile(info)) {
-            if (showFile)
-                std::cout << fullname.c_str() << std::endl;
-        } else {
-            if (showFile)
-                std::cout << "ReadOnly " << fullname.c_str() << std::endl;
+    // Every chunk replays warm frames, chunks no longer than that only repeat work.
+    size_t warm = (size_t)decayFrames * WARM_DECAYS;
+    size_t chunkSize = (paths.size() + chunkCnt - 1) / chunkCnt;
+    if (warm >= chunkSize) {
+        std::cerr << "Chunks of " << chunkSize << " frames need more than " << warm
+                  << " warm frames, blending in series" << std::endl;
+        chunkCnt = 0;
+        return end();
+    }
+
+    BlendFUtil::init();
+    unsigned chunks = (unsigned)((paths.size() + chunkSize - 1) / std::max((size_t)1, chunkSize));
+    std::vector<FOverlayRef> overlays(chunks);
+    std::vector<FOverlayRef> carryIns(chunks);
+    std::vector<BYTE> chunkOkay(chunks, 0);
+    std::cout << "Blend " << chunks << " chunks of " << chunkSize << " frames, warm " << warm << " frames" << std::endl;
+
+    FThreadPool::get().forEach(chunks, [&](unsigned chunk) {
+        size_t first = chunk * chunkSize;
+        chunkOkay[chunk] = BlendFUtil::BlendChunk(paths, first, std::min(first + chunkSize, paths.size()), warm,
+            blendCfg, overlays[chunk], carryIns[chunk]);
+    });
+
+    unsigned redone = 0;
+    for (unsigned chunk = 1; chunk < chunks && ! abortFlag; chunk++) {
+        if (! FOverlay::Same(overlays[chunk - 1].get(), carryIns[chunk].get())) {
+            size_t first = chunk * chunkSize;
+            FOverlayRef unusedRef;
+            chunkOkay[chunk] = BlendFUtil::BlendChunk(paths, first, std::min(first + chunkSize, paths.size()), 0,
+                blendCfg, overlays[chunk - 1], unusedRef);
+            overlays[chunk].swap(overlays[chunk - 1]);
+            redone++;
         }
-        paths.push_back(fullname);
+    }
+    std::cout << "Chunks blended again " << redone << std::endl;
 
+    if (chunks != 0 && overlays.back() != nullptr) {
+        FImageRef overlayImgRef(overlays.back()->ToImage());
+        FPrint::printInfo(overlayImgRef, "overlayImg");
+        okay = BlendFUtil::saveTo(overlayImgRef, "/tmp/ftestOverlay.png");
     }
+    // Any frame of any chunk which failed to load or save fails the blend.
+    return okay && std::find(chunkOkay.begin(), chunkOkay.end(), 0) == chunkOkay.end();
+}
 
-    return fileCount;
+//-------------------------------------------------------------------------------------------------
+// Final composite only. Frames before the last are decoded in parallel and blended into
+// the overlay finalBatch frames at a time (FOverlay::UpdateFrames), without making their output.
+// Only the last frame output and the overlay are saved.
+bool CmdBlendF::endFinal() {
+    bool okay = false;
+    BlendFUtil::init();
+
+    size_t last = paths.empty() ? 0 : paths.size() - 1;
+    size_t first = (FTemporal::DecayFrames(blendCfg) == 0) ? last : 0;    // No overlay, only last frame matters
+    for (size_t batch = first; batch < last && ! abortFlag; batch += finalBatch) {
+        size_t count = std::min((size_t)finalBatch, last - batch);
+        std::vector<FImageRef> imgI8Refs(count);
+        FThreadPool::get().forEach((unsigned)count, [&](unsigned idx) {
+            imgI8Refs[idx].reset(new FImage());
+            BlendFUtil::LoadImage(*imgI8Refs[idx], paths[batch + idx]);
+        });
+        std::vector<lstring> names(paths.begin() + batch, paths.begin() + batch + count);
+        BlendFUtil::UpdateFrames(imgI8Refs, names, blendCfg, overlayRef);
+    }
+
+    FImage imgI8;
+    if (! paths.empty() && ! abortFlag && BlendFUtil::LoadImage(imgI8, paths[last]).Valid()
+        && BlendFUtil::BlendFrame(imgI8, paths[last], blendCfg, overlayRef, outImgRef)) {
+        lstring outFname;
+        FileUtil::getName(outFname, paths[last]);
+        okay = BlendFUtil::saveTo(*outImgRef, outFname);
+    }
+    outImgRef.reset();
+
+    if (overlayRef != nullptr) {
+        FImageRef overlayImgRef(overlayRef->ToImage());
+        overlayRef.reset();
+        FPrint::printInfo(overlayImgRef, "overlayImg");
+        okay = BlendFUtil::saveTo(overlayImgRef, "/tmp/ftestOverlay.png") && okay;
+    }
+    return okay;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -142,12 +447,65 @@ bool CmdBlendF::end() {
     }
     */
 
-    for (const std::string& fullname : paths) {
-        // BlendFUtil::dump(fullname);
-        BlendFUtil::Blend(fullname.c_str(), blendCfg, overlayImgRef);
+    if (finalBatch > 0) {
+        return endFinal();
+    }
+    if (chunkCnt > 1) {
+        return endChunks();
+    }
+
+    // Bounded pipeline, frames are decoded ahead and encoded behind the in order blend.
+    // Blend stage owns the overlay, output images cycle between blend and encode.
+    // Animation frames are added in order, one add runs while the next frame is blended.
+    std::unique_ptr<FApng> apngRef;
+    if (! apngName.empty()) {
+        apngRef.reset(new FApng(apngName, apngDelay));
+        if (! apngRef->Valid()) {
+            std::cerr << "Failed to create " << apngName << std::endl;
+            return false;
+        }
+    }
+    FApng* apng = apngRef.get();
+    FPipeline::EncodeFn encodeFn = [apng](const FImage& outImg, const lstring& outFname) {
+        return (apng != nullptr) ? apng->Add(outImg) : BlendFUtil::saveTo(outImg, outFname, false);
+    };
+    FPipeline::DoneFn doneFn = [apng](bool encoded, const lstring& outFname) {
+        if (apng == nullptr) {
+            BlendFUtil::reportSave(encoded, outFname);
+        } else if (! encoded) {
+            std::cerr << "Animation frame FAILED " << outFname << std::endl;
+        }
+    };
+
+    {
+        FPipeline pipeline(paths, abortFlag);
+        size_t idx;
+        FImageRef imgI8Ref;
+        while (pipeline.Next(idx, imgI8Ref)) {
+            if (outImgRef == nullptr) {
+                outImgRef = pipeline.ReuseImage();
+            }
+            if (BlendFUtil::BlendFrame(*imgI8Ref, paths[idx], blendCfg, overlayRef, outImgRef)) {
+                lstring outFname;
+                FileUtil::getName(outFname, paths[idx]);
+                if (apng != nullptr) {
+                    pipeline.WaitEncodes();
+                }
+                pipeline.Encode(outImgRef, outFname, encodeFn, doneFn);
+            }
+        }
+        pipeline.Finish();
+    }
+    if (apngRef != nullptr) {
+        unsigned frames = apngRef->Frames();
+        BlendFUtil::reportSave(apngRef->Close(), apngName);
+        std::cout << "Animation " << frames << " frames" << std::endl;
     }
+    outImgRef.reset();
 
-    if (overlayImgRef != nullptr) {
+    if (overlayRef != nullptr) {
+        FImageRef overlayImgRef(overlayRef->ToImage());
+        overlayRef.reset();
         FPrint::printInfo(overlayImgRef, "overlayImg");
         // FPrint::printPalette(*overlayImgRef);
         // FPrint::printHisto(*overlayImgRef);
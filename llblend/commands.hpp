@@ -98,10 +98,18 @@ public:
 
     virtual size_t add( const lstring& file, DIR_TYPES dtypes) = 0;
 
+    // Add the frames of a frame pack (FPack) in place of the pack file.
+    size_t addPack(const lstring& packPath);
+
     virtual bool end() {
         return true;
     }
 
+protected:
+    // Expand a frame pack, or push a file passing the include and exclude filters, onto paths.
+    size_t addPath(const lstring& fullname, DIR_TYPES dtype, StringList& paths);
+
+public:
     Command& share(const Command& other) {
         includeFilePatList = other.includeFilePatList;
         excludeFilePatList = other.excludeFilePatList;
@@ -132,14 +140,87 @@ public:
     size_t add(const lstring& file, DIR_TYPES dtype);
 };
 
+// ---------------------------------------------------------------------------
+class CmdBenchF : public Command {
+    const BlendCfg& blendCfg;
+
+public:
+    CmdBenchF(const BlendCfg& cfg) : Command('t'), blendCfg(cfg) {}
+    size_t add(const lstring& file, DIR_TYPES dtype);
+};
+
+// ---------------------------------------------------------------------------
+// Maximum pixel index over all frames, frames reduced in parallel.
+class CmdMaximumF : public Command {
+    const BlendCfg& blendCfg;
+    StringList paths;
+
+public:
+    lstring outName = "maximum.png";
+
+    CmdMaximumF(const BlendCfg& cfg) : Command('m'), blendCfg(cfg) {}
+    size_t add(const lstring& file, DIR_TYPES dtype);
+    bool end();
+};
+
+// ---------------------------------------------------------------------------
+// Sliding window maximum (or mean with -mode=mean) index over the last windowFrames frames,
+// one output per frame.
+class CmdWindowF : public Command {
+    const BlendCfg& blendCfg;
+    StringList paths;
+
+public:
+    unsigned windowFrames = 12;
+
+    CmdWindowF(const BlendCfg& cfg) : Command('w'), blendCfg(cfg) {}
+    size_t add(const lstring& file, DIR_TYPES dtype);
+    bool end();
+};
+
+// ---------------------------------------------------------------------------
+// Independently decayed overlay per class (BlendCfg::classes) from one decode of each frame,
+// one output per class per frame.
+class CmdClassF : public Command {
+    const BlendCfg& blendCfg;
+    StringList paths;
+
+public:
+    CmdClassF(const BlendCfg& cfg) : Command('c'), blendCfg(cfg) {}
+    size_t add(const lstring& file, DIR_TYPES dtype);
+    bool end();
+};
+
+// ---------------------------------------------------------------------------
+// Pack matching frames into one FPack file, replayed by the other commands through mmap.
+class CmdPackF : public Command {
+    StringList paths;
+
+public:
+    lstring outName = "frames.llpack";
+    bool lz4 = true;            // Else raw planes
+
+    CmdPackF() : Command('k') {}
+    size_t add(const lstring& file, DIR_TYPES dtype);
+    bool end();
+};
 
 // ---------------------------------------------------------------------------
 class CmdBlendF : public Command {
     const BlendCfg& blendCfg;
-    FImageRef overlayImgRef;
+    FOverlayRef overlayRef;
+    FImageRef outImgRef;        // Reused per frame output image
     StringList paths;
 
+    bool endChunks();
+    bool endFinal();
+
 public:
+    unsigned chunkCnt = 0;      // Blend frame chunks in parallel when > 1
+    unsigned finalBatch = 0;    // Only save last frame, overlay updated by batches of frames when > 0
+    lstring apngName;           // Save outputs as frames of one animated png when set
+    unsigned apngDelay = 100;   // Animation milliseconds per frame
+
     CmdBlendF(const BlendCfg& cfg) : Command('b'), blendCfg(cfg) {}
     bool begin(StringList& fileDirList);
     size_t add(const lstring& file, DIR_TYPES dtype);
@@ -0,0 +1,102 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FClasses.cpp
+//  Desc: Independently decayed overlay per precipitation class of 8bit index frames.
+//
+//  FClasses created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+
+#include "fclasses.hpp"
+#include "blendfutil.hpp"
+#include "fthreadpool.hpp"
+
+#include <algorithm>
+#include <string.h>
+
+// -------------------------------------------------------------------------------------------------
+FClasses::FClasses(const std::vector<BlendClass>& _classes, float defDecay, unsigned _width, unsigned _height)
+    : width(_width), height(_height), classes(_classes) {
+    memset(classTable, 0, sizeof(classTable));
+    for (unsigned cls = (unsigned)classes.size(); cls-- > 0; ) {
+        for (unsigned idx = std::max(classes[cls].first, (BYTE)1); idx <= classes[cls].last; idx++) {
+            classTable[idx] = (BYTE)(cls + 1);     // First class listed wins
+        }
+    }
+    for (const BlendClass& cls : classes) {
+        overlays.emplace_back(FImage::Allocate(width, height, 32));
+        overlays.back()->FillImage(FPalette::TRANSPARENT);
+        decays.push_back((cls.decay > 0) ? cls.decay : defDecay);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+void FClasses::Composite(unsigned cls, const FColor* frameLut, const FImage& frameI8, FImage& outP32) {
+    BlendFUtil::DecayExpandBlendI8_P32(frameLut, frameI8, *overlays[cls], decays[cls], outP32);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Blend runs of pixels of the same class in [x0, x1) into the row of their class overlay.
+void FClasses::updateRun(const FColor* overlayLut, const BYTE* idx, unsigned y, unsigned x0, unsigned x1) {
+    while (x0 < x1) {
+        BYTE cls = classTable[idx[x0]];
+        unsigned x = x0 + 1;
+        while (x < x1 && classTable[idx[x]] == cls) {
+            x++;
+        }
+        if (cls != 0) {
+            FColor* row = (FColor*)overlays[cls - 1]->ScanLine(y);
+            FKernel::lutBlendOverRow(overlayLut, idx + x0, row + x0, x - x0);
+        }
+        x0 = x;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// Index 0 is in no class, so only the non transparent spans of the frame are scanned.
+void FClasses::Update(const FColor* overlayLut, const FImage& frameI8) {
+    unsigned rows = std::min(height, frameI8.GetHeight());
+    unsigned cols = std::min(width, frameI8.GetWidth());
+    const FSpans* spans = BlendFUtil::useSpans ? &frameI8.Spans() : nullptr;
+
+    FThreadPool::get().forBands(rows, cols, [&](unsigned y0, unsigned y1) {
+        for (unsigned y = y0; y < y1; y++) {
+            const BYTE* idx = frameI8.ReadScanLine(y);
+            if (spans != nullptr) {
+                for (const FSpan* span = spans->begin(y); span != spans->end(y) && span->x < cols; span++) {
+                    updateRun(overlayLut, idx, y, span->x, std::min(span->x + span->len, cols));
+                }
+            } else {
+                updateRun(overlayLut, idx, y, 0, cols);
+            }
+        }
+    });
+}
@@ -0,0 +1,72 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FClasses.hpp
+//  Desc: Independently decayed overlay per precipitation class of 8bit index frames.
+//
+//  FClasses created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#pragma once
+
+#include "fimage.hpp"
+#include "blendcfg.hpp"
+
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// One straight alpha 32bit overlay per class, each with its own decay. Frame pixels are
+// routed to the overlay of their class by a 256 entry class table, in one scan of the frame,
+// so one decode of each frame feeds every class. Each class overlay is composited over
+// the frame on its own, as if llblend was run once per class with that class mapped.
+//   1. Composite - per class, decay overlay one frame and blend it over the frame
+//   2. Update    - blend each frame pixel into the overlay of its class
+class FClasses {
+public:
+    const unsigned width;
+    const unsigned height;
+    const std::vector<BlendClass> classes;
+
+    // Overlapping index ranges go to the first class listed, decay of 0 uses defDecay.
+    FClasses(const std::vector<BlendClass>& classes, float defDecay, unsigned width, unsigned height);
+
+    void Composite(unsigned cls, const FColor* frameLut, const FImage& frameI8, FImage& outP32);
+    void Update(const FColor* overlayLut, const FImage& frameI8);
+
+    unsigned Count() const
+    { return (unsigned)classes.size(); }
+
+private:
+    BYTE classTable[256];               // Frame index to class + 1, 0 is not in any class
+    std::vector<FImageRef> overlays;
+    std::vector<float> decays;
+
+    void updateRun(const FColor* overlayLut, const BYTE* idx, unsigned y, unsigned x0, unsigned x1);
+};
@@ -39,6 +39,9 @@
 
 #include "fcolor.hpp"
 
+#include <math.h>
+#include <algorithm>
+
 
 
 void FColor::blendOver(RGBQUAD& botColor) const {
@@ -52,3 +55,86 @@ void FColor::blendOver(RGBQUAD& botColor) const {
         botColor.rgbReserved = 0xff;
     }
 }
+
+// -------------------------------------------------------------------------------------------------
+FColor FColor::premultiplied() const {
+    unsigned alpha = rgbReserved;
+    return FColor(
+        (BYTE)(rgbRed * alpha / 255),
+        (BYTE)(rgbGreen * alpha / 255),
+        (BYTE)(rgbBlue * alpha / 255),
+        rgbReserved);
+}
+
+// -------------------------------------------------------------------------------------------------
+FColor FColor::straight() const {
+    unsigned recip = reciprocal255()[rgbReserved];
+    return FColor(
+        clamp((rgbRed * recip + 0x8000) >> 16),
+        clamp((rgbGreen * recip + 0x8000) >> 16),
+        clamp((rgbBlue * recip + 0x8000) >> 16),
+        rgbReserved);
+}
+
+// -------------------------------------------------------------------------------------------------
+void FColor::premulOver(RGBQUAD& botColor) const {
+    unsigned inv = 255 - rgbReserved;
+    botColor.rgbRed      = (BYTE)(rgbRed      + botColor.rgbRed      * inv / 255);
+    botColor.rgbGreen    = (BYTE)(rgbGreen    + botColor.rgbGreen    * inv / 255);
+    botColor.rgbBlue     = (BYTE)(rgbBlue     + botColor.rgbBlue     * inv / 255);
+    botColor.rgbReserved = (BYTE)(rgbReserved + botColor.rgbReserved * inv / 255);
+}
+
+// -------------------------------------------------------------------------------------------------
+const unsigned* FColor::reciprocal255() {
+    struct Table {
+        unsigned recip[256];
+        Table() {
+            recip[0] = 0;
+            for (unsigned alpha = 1; alpha < 256; alpha++) {
+                recip[alpha] = (255 * 65536 + alpha / 2) / alpha;
+            }
+        }
+    };
+    static const Table table;
+    return table.recip;
+}
+
+// -------------------------------------------------------------------------------------------------
+const WORD* FColor::srgbToLinear() {
+    struct Table {
+        WORD linear[256 + 2];
+        Table() {
+            for (unsigned c = 0; c < 256; c++) {
+                double srgb = c / 255.0;
+                double linear = (srgb <= 0.04045) ? srgb / 12.92 : pow((srgb + 0.055) / 1.055, 2.4);
+                this->linear[c] = (WORD)(linear * 65535 + 0.5);
+            }
+            linear[256] = linear[257] = 0;
+        }
+    };
+    static const Table table;
+    return table.linear;
+}
+
+// -------------------------------------------------------------------------------------------------
+const BYTE* FColor::linearToSrgb() {
+    struct Table {
+        BYTE srgb[LINEAR_SRGB_SIZE + 3];
+        Table() {
+            for (unsigned idx = 0; idx < LINEAR_SRGB_SIZE; idx++) {
+                double linear = std::min(1.0, (idx + 0.5) * (1 << LINEAR_SHIFT) / (65535.0 * 255));
+                double value = (linear <= 0.0031308) ? linear * 12.92 : 1.055 * pow(linear, 1 / 2.4) - 0.055;
+                srgb[idx] = (BYTE)(value * 255 + 0.5);
+            }
+            // Unmixed colors come back unchanged, the sRGB steps are wider than an index.
+            const WORD* lin = srgbToLinear();
+            for (unsigned c = 0; c < 256; c++) {
+                srgb[lin[c] * 255 >> LINEAR_SHIFT] = (BYTE)c;
+            }
+            srgb[LINEAR_SRGB_SIZE] = srgb[LINEAR_SRGB_SIZE + 1] = srgb[LINEAR_SRGB_SIZE + 2] = 0;
+        }
+    };
+    static const Table table;
+    return table.srgb;
+}
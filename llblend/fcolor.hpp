@@ -42,6 +42,13 @@
 // #include "fimage.hpp"
 #include "freeimage/FreeImage.h"
 
+// Porter-Duff compositing operators plus the separable multiply and screen blends.
+enum CompositeOp {
+    COMPOSITE_OVER, COMPOSITE_IN, COMPOSITE_OUT, COMPOSITE_ATOP, COMPOSITE_XOR,
+    COMPOSITE_PLUS, COMPOSITE_MULTIPLY, COMPOSITE_SCREEN,
+    COMPOSITE_OPS
+};
+
 class FColor : public RGBQUAD {
 public:
 
@@ -84,6 +91,53 @@ public:
     }
 
     void blendOver(RGBQUAD& botColor) const;
+    // blendOver mixing in linear light,  lin = srgbToLinear(), srgb = linearToSrgb().
+    void blendOverLinear(RGBQUAD& botColor, const WORD* lin, const BYTE* srgb) const {
+        if (botColor.rgbReserved == 0) {
+            botColor = *this;
+        } else if (rgbReserved != 0) {
+            unsigned alpha = rgbReserved;
+            unsigned inv = 255 - alpha;
+            botColor.rgbRed   = srgb[(lin[rgbRed]   * alpha + lin[botColor.rgbRed]   * inv) >> LINEAR_SHIFT];
+            botColor.rgbGreen = srgb[(lin[rgbGreen] * alpha + lin[botColor.rgbGreen] * inv) >> LINEAR_SHIFT];
+            botColor.rgbBlue  = srgb[(lin[rgbBlue]  * alpha + lin[botColor.rgbBlue]  * inv) >> LINEAR_SHIFT];
+            botColor.rgbReserved = 0xff;
+        }
+    }
+
+    // Premultiplied alpha, color channels scaled by alpha / 255.
+    FColor premultiplied() const;
+    // Straight alpha from premultiplied, uses reciprocal255 (no divide).
+    FColor straight() const;
+    // Premultiplied source over,  bot = this + bot * (255 - alpha) / 255  for all four channels.
+    void premulOver(RGBQUAD& botColor) const;
+    // Premultiplied decay,  all four channels * scale / 256.
+    void premulDecay(unsigned scale) {
+        rgbRed = (BYTE)(rgbRed * scale / 256);
+        rgbGreen = (BYTE)(rgbGreen * scale / 256);
+        rgbBlue = (BYTE)(rgbBlue * scale / 256);
+        rgbReserved = (BYTE)(rgbReserved * scale / 256);
+    }
+
+    // Straight alpha top OP bot, computed premultiplied (see compositePremul).
+    static FColor composite(CompositeOp op, const FColor& top, const FColor& bot) {
+        return compositePremul(op, top, bot).straight();
+    }
+    // Straight alpha inputs, premultiplied result for all four channels,
+    //   (A * top + B * bot + C * top * bot) / 255  with A, B, C from the operator and alphas.
+    static inline FColor compositePremul(CompositeOp op, const FColor& top, const FColor& bot);
+
+    // [alpha] = 255 * 65536 / alpha rounded, [0] = 0.
+    static const unsigned* reciprocal255();
+
+    // Linear light tables, 16bit fixed point linear 0..65535.
+    // A linear mix  lin * alpha + lin * (255 - alpha)  >> LINEAR_SHIFT  indexes linearToSrgb.
+    static const unsigned LINEAR_SHIFT = 12;
+    static const unsigned LINEAR_SRGB_SIZE = (65535 * 255 >> LINEAR_SHIFT) + 1;
+    // [sRGB byte] = linear light, padded for 32bit gathers.
+    static const WORD* srgbToLinear();
+    // [linear mix >> LINEAR_SHIFT] = sRGB byte, round trips lin[c] * 255 to c, padded for 32bit gathers.
+    static const BYTE* linearToSrgb();
 
     static
     BYTE clamp(unsigned cBig) {
@@ -117,3 +171,36 @@ public:
         return dRed * dRed + dGreen * dGreen + dBlue * dBlue;
     }
 };
+
+// -------------------------------------------------------------------------------------------------
+inline FColor FColor::compositePremul(CompositeOp op, const FColor& topColor, const FColor& botColor) {
+    FColor top = topColor.premultiplied();
+    FColor bot = botColor.premultiplied();
+    unsigned topAlpha = top.rgbReserved;
+    unsigned botAlpha = bot.rgbReserved;
+    if (op == COMPOSITE_PLUS) {
+        return FColor(
+            clamp(top.rgbRed + bot.rgbRed),
+            clamp(top.rgbGreen + bot.rgbGreen),
+            clamp(top.rgbBlue + bot.rgbBlue),
+            clamp(topAlpha + botAlpha));
+    }
+
+    unsigned a = (op == COMPOSITE_OVER || op == COMPOSITE_SCREEN) ? 255
+        : (op == COMPOSITE_IN || op == COMPOSITE_ATOP) ? botAlpha : 255 - botAlpha;
+    unsigned b = (op == COMPOSITE_IN || op == COMPOSITE_OUT) ? 0
+        : (op == COMPOSITE_SCREEN) ? 255 : 255 - topAlpha;
+    auto channel = [=](unsigned t, unsigned d) {
+        unsigned sum = a * t + b * d;
+        if (op == COMPOSITE_MULTIPLY)
+            sum += t * d;
+        else if (op == COMPOSITE_SCREEN)
+            sum -= t * d;
+        return (BYTE)(sum / 255);
+    };
+    return FColor(
+        channel(top.rgbRed, bot.rgbRed),
+        channel(top.rgbGreen, bot.rgbGreen),
+        channel(top.rgbBlue, bot.rgbBlue),
+        channel(topAlpha, botAlpha));
+}
@@ -34,17 +34,28 @@
 // CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "fimage.hpp"
+#include "fkernel.hpp"
+#include "fthreadpool.hpp"
 #include <iostream>
 
-unsigned FImage::DBG_CNT = 0;
+std::atomic<unsigned> FImage::DBG_CNT(0);
 
 // ----------------------------------------------------------
 FImage::FImage(FIBITMAP* _imgPtr) : imgPtr(_imgPtr) {
     DBG_CNT++;
 }
 
+// ----------------------------------------------------------
+const FSpans& FImage::Spans(BYTE clearIdx) const {
+    if (spansRef == nullptr || spansRef->clearIdx != clearIdx) {
+        spansRef = std::make_shared<FSpans>(*this, clearIdx);
+    }
+    return *spansRef;
+}
+
 // ----------------------------------------------------------
 void FImage::Close() {
+    spansRef.reset();
     if (Valid()) {
         FreeImage_Unload(imgPtr);
         imgPtr = nullptr;
@@ -60,8 +71,17 @@ bool FImage::LoadFromHandle(FREE_IMAGE_FORMAT fif, FreeImageIO *io, fi_handle ha
     return Valid();
 }
 
+// ----------------------------------------------------------
+bool FImage::LoadFromMemory(FREE_IMAGE_FORMAT fif, FIMEMORY *stream, int flags) {
+    Close();
+    DBG_CNT++;
+    imgPtr = FreeImage_LoadFromMemory(fif, stream, flags);
+    return Valid();
+}
+
 // ------------------------------------------------------
 void FImage::FillImage(const FColor& color) {
+    ClearSpans();
     unsigned width = GetWidth();
     unsigned height = GetHeight();
     unsigned bitsPerPixel = GetBitsPerPixel();
@@ -72,10 +92,12 @@ void FImage::FillImage(const FColor& color) {
     case 8:
     case 32:
         // TODO - use fill color.
-        for (unsigned y = 0; y < height; y++) {
-            BYTE* bits = ScanLine(y);
-            memset(bits, 0, width);
-        }
+        FThreadPool::get().forBands(height, width, [&](unsigned y0, unsigned y1) {
+            for (unsigned y = y0; y < y1; y++) {
+                BYTE* bits = ScanLine(y);
+                memset(bits, 0, width);
+            }
+        });
         break;
     default:
         // TODO - handle all image types
@@ -130,13 +152,11 @@ void FImage::AdjustAlphaP32(float percent) {
     unsigned scale = (unsigned)(256 * percent);
     unsigned width  = GetWidth();
     unsigned height = GetHeight();
-    for (unsigned y = 0; y < height; y++) {
-        RGBQUAD* argbPtr = (RGBQUAD*)ScanLine(y);
-        for (unsigned x = 0; x < width; x++) {
-            RGBQUAD& argb = *argbPtr++;
-            argb.rgbReserved = argb.rgbReserved * scale / 256;
+    FThreadPool::get().forBands(height, width * 4, [&](unsigned y0, unsigned y1) {
+        for (unsigned y = y0; y < y1; y++) {
+            FKernel::decayRow((FColor*)ScanLine(y), scale, width);
         }
-    }
+    });
 }
 
 // ----------------------------------------------------------
@@ -144,6 +164,7 @@ void FImage::DrawRectangleI8(
     const FBrush& brush,
     unsigned x1, unsigned y1, unsigned x2, unsigned y2) {
     BYTE pixel = brush.fillIndex;
+    ClearSpans();
 
 
     for (unsigned y = y1; y < y2; y++) {
@@ -53,7 +53,9 @@
 #include "fpalette.hpp"
 #include "fcolor.hpp"
 #include "fbrush.hpp"
+#include "fspans.hpp"
 
+#include <atomic>
 #include <iostream>
 
 
@@ -78,8 +80,9 @@ public:
 class FImage {
 public:
 
-    static unsigned DBG_CNT;
+    static std::atomic<unsigned> DBG_CNT;
     FIBITMAP* imgPtr;
+    mutable FSpansRef spansRef;     // 8bit non clear spans, built on first use
 
     FImage() : imgPtr(nullptr)
     { }
@@ -152,7 +155,13 @@ public:
     BYTE* TransparencyTable()
     { return FreeImage_GetTransparencyTable(imgPtr); }
     unsigned ApplyPaletteIndexMapping(const BYTE *srcindices, const BYTE *dstindices, unsigned count, bool swap = false)
-    { return FreeImage_ApplyPaletteIndexMapping(imgPtr, (BYTE*)srcindices, (BYTE*)dstindices, count, swap); }
+    { ClearSpans(); return FreeImage_ApplyPaletteIndexMapping(imgPtr, (BYTE*)srcindices, (BYTE*)dstindices, count, swap); }
+
+    // Spans of 8bit pixels not clearIdx, cached until ClearSpans.
+    // Call ClearSpans after changing pixels with ScanLine or SetPixelIndex.
+    const FSpans& Spans(BYTE clearIdx = 0) const;
+    void ClearSpans() const
+    { spansRef.reset(); }
 
     FImage ConvertTo24Bits() const
     { return FImage(FreeImage_ConvertTo24Bits(imgPtr)); }
@@ -165,9 +174,13 @@ public:
 
 
 
+    FImage* Clone() const
+    { return new FImage(FreeImage_Clone(imgPtr)); }
+
     static FImage* Allocate(int width, int height, int bpp = 32, unsigned red_mask = 0xff0000, unsigned green_mask = 0xff00, unsigned blue_mask = 0xff)
     { return new FImage(FreeImage_Allocate( width,  height,  bpp,  red_mask,  green_mask,  blue_mask)); }
     bool LoadFromHandle(FREE_IMAGE_FORMAT fif, FreeImageIO *io, fi_handle handle, int flags = 0);
+    bool LoadFromMemory(FREE_IMAGE_FORMAT fif, FIMEMORY *stream, int flags = 0);
     void FillImage(const FColor& color);
     void AdjustAlphaP32(float percent);
     FPalette& getPalette(FPalette& palette) const;
@@ -0,0 +1,1626 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FKernel.cpp
+//  Desc: Scanline pixel kernels (SIMD) with runtime cpu dispatch.
+//
+//  FKernel created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "fkernel.hpp"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+    #define HAVE_X86
+    #include <immintrin.h>
+    #ifdef _MSC_VER
+        #include <intrin.h>
+        #define LL_TARGET(isa)
+    #else
+        #define LL_TARGET(isa) __attribute__((target(isa)))
+    #endif
+#endif
+
+FKernel::Isa FKernel::isa = FKernel::ISA_SCALAR;
+bool FKernel::linear = false;
+
+// =================================================================================================
+//  Scalar kernels (reference implementation)
+// =================================================================================================
+
+// -------------------------------------------------------------------------------------------------
+static void BlendOverRowScalar(const FColor* top, FColor* bot, unsigned width) {
+    for (unsigned x = 0; x < width; x++) {
+        top[x].blendOver(bot[x]);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+static void ExpandBlendRowScalar(const FColor* lut, const BYTE* idx, const FColor* top, FColor* out, unsigned width) {
+    if (top == nullptr) {
+        for (unsigned x = 0; x < width; x++) {
+            out[x] = lut[idx[x]];
+        }
+    } else {
+        for (unsigned x = 0; x < width; x++) {
+            out[x] = lut[idx[x]];
+            top[x].blendOver(out[x]);
+        }
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// Same math as FImage::AdjustAlphaP32, scale = 256 * percent
+static void DecayRowScalar(FColor* row, unsigned scale, unsigned width) {
+    for (unsigned x = 0; x < width; x++) {
+        row[x].rgbReserved = row[x].rgbReserved * scale / 256;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+static void DecayExpandBlendRowScalar(const FColor* lut, const BYTE* idx, FColor* top, unsigned scale, FColor* out, unsigned width) {
+    for (unsigned x = 0; x < width; x++) {
+        top[x].rgbReserved = top[x].rgbReserved * scale / 256;
+        out[x] = lut[idx[x]];
+        top[x].blendOver(out[x]);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+static void LutBlendOverRowScalar(const FColor* lut, const BYTE* idx, FColor* bot, unsigned width) {
+    for (unsigned x = 0; x < width; x++) {
+        lut[idx[x]].blendOver(bot[x]);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+static void MaxRowScalar(const BYTE* in, BYTE* out, unsigned width) {
+    for (unsigned x = 0; x < width; x++) {
+        out[x] = (in[x] > out[x]) ? in[x] : out[x];
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+static void PremulLutOverRowScalar(const FColor* lut, const BYTE* idx, FColor* bot, unsigned width) {
+    for (unsigned x = 0; x < width; x++) {
+        lut[idx[x]].premulOver(bot[x]);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+static void PremulDecayOverRowScalar(const FColor* lut, const BYTE* idx, FColor* top, unsigned scale, FColor* out, unsigned width) {
+    for (unsigned x = 0; x < width; x++) {
+        top[x].premulDecay(scale);
+        out[x] = lut[idx[x]];
+        top[x].premulOver(out[x]);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+static void StraightRowScalar(FColor* row, unsigned width) {
+    for (unsigned x = 0; x < width; x++) {
+        row[x] = row[x].straight();
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+static void DecayA16RowScalar(WORD* alpha16, FColor* row, unsigned scale, unsigned width) {
+    for (unsigned x = 0; x < width; x++) {
+        alpha16[x] = (WORD)(alpha16[x] * scale >> 16);
+        row[x].rgbReserved = (BYTE)((alpha16[x] + 128) >> 8);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+static void LutBlendOverA16RowScalar(const FColor* lut, const BYTE* idx, FColor* bot, WORD* alpha16, unsigned width) {
+    for (unsigned x = 0; x < width; x++) {
+        const FColor& top = lut[idx[x]];
+        if (top.rgbReserved != 0 || bot[x].rgbReserved == 0) {
+            top.blendOver(bot[x]);
+            alpha16[x] = (WORD)(bot[x].rgbReserved << 8);
+        }
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+static void DecayPlaneRowScalar(BYTE* alpha, unsigned scale, unsigned width) {
+    for (unsigned x = 0; x < width; x++) {
+        alpha[x] = (BYTE)(alpha[x] * scale / 256);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+static void InterleaveRowScalar(const BYTE* blue, const BYTE* green, const BYTE* red, const BYTE* alpha, FColor* out, unsigned width) {
+    for (unsigned x = 0; x < width; x++) {
+        out[x] = FColor(red[x], green[x], blue[x], alpha[x]);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+static void DeinterleaveRowScalar(const FColor* in, BYTE* blue, BYTE* green, BYTE* red, BYTE* alpha, unsigned width) {
+    for (unsigned x = 0; x < width; x++) {
+        blue[x] = in[x].rgbBlue;
+        green[x] = in[x].rgbGreen;
+        red[x] = in[x].rgbRed;
+        alpha[x] = in[x].rgbReserved;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// Linear light versions of the blendOver kernels, FColor::blendOverLinear.
+static void BlendOverLinearRowScalar(const FColor* top, FColor* bot, unsigned width) {
+    const WORD* lin = FColor::srgbToLinear();
+    const BYTE* srgb = FColor::linearToSrgb();
+    for (unsigned x = 0; x < width; x++) {
+        top[x].blendOverLinear(bot[x], lin, srgb);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+static void ExpandBlendLinearRowScalar(const FColor* lut, const BYTE* idx, const FColor* top, FColor* out, unsigned width) {
+    if (top == nullptr) {
+        ExpandBlendRowScalar(lut, idx, top, out, width);
+        return;
+    }
+    const WORD* lin = FColor::srgbToLinear();
+    const BYTE* srgb = FColor::linearToSrgb();
+    for (unsigned x = 0; x < width; x++) {
+        out[x] = lut[idx[x]];
+        top[x].blendOverLinear(out[x], lin, srgb);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+static void DecayExpandBlendLinearRowScalar(const FColor* lut, const BYTE* idx, FColor* top, unsigned scale, FColor* out, unsigned width) {
+    const WORD* lin = FColor::srgbToLinear();
+    const BYTE* srgb = FColor::linearToSrgb();
+    for (unsigned x = 0; x < width; x++) {
+        top[x].rgbReserved = top[x].rgbReserved * scale / 256;
+        out[x] = lut[idx[x]];
+        top[x].blendOverLinear(out[x], lin, srgb);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+static void LutBlendOverLinearRowScalar(const FColor* lut, const BYTE* idx, FColor* bot, unsigned width) {
+    const WORD* lin = FColor::srgbToLinear();
+    const BYTE* srgb = FColor::linearToSrgb();
+    for (unsigned x = 0; x < width; x++) {
+        lut[idx[x]].blendOverLinear(bot[x], lin, srgb);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// out[x] = top[x] OP bot[x] premultiplied, straightened by the caller once the row is done.
+template <CompositeOp OP>
+static void CompositePremulRowScalar(const FColor* top, const FColor* bot, FColor* out, unsigned width) {
+    for (unsigned x = 0; x < width; x++) {
+        out[x] = FColor::compositePremul(OP, top[x], bot[x]);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+template <CompositeOp OP>
+static void CompositeRowScalar(const FColor* top, const FColor* bot, FColor* out, unsigned width) {
+    CompositePremulRowScalar<OP>(top, bot, out, width);
+    StraightRowScalar(out, width);
+}
+
+static const FKernel::CompositeRowFn CompositeRowsScalar[COMPOSITE_OPS] = {
+    CompositeRowScalar<COMPOSITE_OVER>, CompositeRowScalar<COMPOSITE_IN>,
+    CompositeRowScalar<COMPOSITE_OUT>, CompositeRowScalar<COMPOSITE_ATOP>,
+    CompositeRowScalar<COMPOSITE_XOR>, CompositeRowScalar<COMPOSITE_PLUS>,
+    CompositeRowScalar<COMPOSITE_MULTIPLY>, CompositeRowScalar<COMPOSITE_SCREEN>
+};
+
+FKernel::BlendOverRowFn FKernel::blendOverRow = BlendOverRowScalar;
+FKernel::ExpandBlendRowFn FKernel::expandBlendRow = ExpandBlendRowScalar;
+FKernel::DecayRowFn FKernel::decayRow = DecayRowScalar;
+FKernel::DecayExpandBlendRowFn FKernel::decayExpandBlendRow = DecayExpandBlendRowScalar;
+FKernel::LutBlendOverRowFn FKernel::lutBlendOverRow = LutBlendOverRowScalar;
+FKernel::MaxRowFn FKernel::maxRow = MaxRowScalar;
+FKernel::PremulLutOverRowFn FKernel::premulLutOverRow = PremulLutOverRowScalar;
+FKernel::PremulDecayOverRowFn FKernel::premulDecayOverRow = PremulDecayOverRowScalar;
+FKernel::StraightRowFn FKernel::straightRow = StraightRowScalar;
+FKernel::DecayA16RowFn FKernel::decayA16Row = DecayA16RowScalar;
+FKernel::LutBlendOverA16RowFn FKernel::lutBlendOverA16Row = LutBlendOverA16RowScalar;
+FKernel::DecayPlaneRowFn FKernel::decayPlaneRow = DecayPlaneRowScalar;
+FKernel::InterleaveRowFn FKernel::interleaveRow = InterleaveRowScalar;
+FKernel::DeinterleaveRowFn FKernel::deinterleaveRow = DeinterleaveRowScalar;
+FKernel::CompositeRowFn FKernel::compositeRow[COMPOSITE_OPS] = {
+    CompositeRowScalar<COMPOSITE_OVER>, CompositeRowScalar<COMPOSITE_IN>,
+    CompositeRowScalar<COMPOSITE_OUT>, CompositeRowScalar<COMPOSITE_ATOP>,
+    CompositeRowScalar<COMPOSITE_XOR>, CompositeRowScalar<COMPOSITE_PLUS>,
+    CompositeRowScalar<COMPOSITE_MULTIPLY>, CompositeRowScalar<COMPOSITE_SCREEN>
+};
+
+#ifdef HAVE_X86
+
+// =================================================================================================
+//  x86 kernels
+//
+//  Channel math is done in 16bit lanes. The exact integer divide by 255 used by
+//  FColor::blendOver is replaced with  (v * 0x8081) >> 23  which is exact for all 16bit v.
+//  Pixel selection matches blendOver:
+//      bot alpha == 0   =>  bot = top
+//      top alpha == 0   =>  bot unchanged
+//      else             =>  bot = mix(top, bot),  alpha = 0xff
+// =================================================================================================
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("sse2") static inline
+__m128i MixHalfSSE2(__m128i top16, __m128i bot16) {
+    const __m128i v255 = _mm_set1_epi16(255);
+    const __m128i div255 = _mm_set1_epi16((short)0x8081);
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(top16, 0xff), 0xff);
+    __m128i sum = _mm_add_epi16(
+        _mm_mullo_epi16(top16, alpha),
+        _mm_mullo_epi16(bot16, _mm_sub_epi16(v255, alpha)));
+    return _mm_srli_epi16(_mm_mulhi_epu16(sum, div255), 7);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("sse2") static inline
+__m128i BlendOver4SSE2(__m128i top, __m128i bot) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaMask = _mm_set1_epi32((int)0xff000000);
+
+    __m128i lo = MixHalfSSE2(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bot, zero));
+    __m128i hi = MixHalfSSE2(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bot, zero));
+    __m128i mix = _mm_or_si128(_mm_packus_epi16(lo, hi), alphaMask);
+
+    __m128i topClear = _mm_cmpeq_epi32(_mm_and_si128(top, alphaMask), zero);
+    __m128i botClear = _mm_cmpeq_epi32(_mm_and_si128(bot, alphaMask), zero);
+    __m128i out = _mm_or_si128(_mm_and_si128(topClear, bot), _mm_andnot_si128(topClear, mix));
+    return _mm_or_si128(_mm_and_si128(botClear, top), _mm_andnot_si128(botClear, out));
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("sse2")
+static void BlendOverRowSSE2(const FColor* top, FColor* bot, unsigned width) {
+    const __m128i alphaMask = _mm_set1_epi32((int)0xff000000);
+    unsigned x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i top4 = _mm_loadu_si128((const __m128i*)(top + x));
+        __m128i bot4 = _mm_loadu_si128((const __m128i*)(bot + x));
+        // Fully transparent overlay, common in radar images, only replaces transparent bottom.
+        if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(top4, alphaMask), _mm_setzero_si128())) == 0xffff) {
+            __m128i botClear = _mm_cmpeq_epi32(_mm_and_si128(bot4, alphaMask), _mm_setzero_si128());
+            if (_mm_movemask_epi8(botClear) != 0)
+                _mm_storeu_si128((__m128i*)(bot + x), _mm_or_si128(_mm_and_si128(botClear, top4), _mm_andnot_si128(botClear, bot4)));
+            continue;
+        }
+        _mm_storeu_si128((__m128i*)(bot + x), BlendOver4SSE2(top4, bot4));
+    }
+    BlendOverRowScalar(top + x, bot + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("sse2")
+static void ExpandBlendRowSSE2(const FColor* lut, const BYTE* idx, const FColor* top, FColor* out, unsigned width) {
+    const int* lut32 = (const int*)lut;
+    unsigned x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i frame4 = _mm_setr_epi32(lut32[idx[x]], lut32[idx[x + 1]], lut32[idx[x + 2]], lut32[idx[x + 3]]);
+        if (top != nullptr) {
+            frame4 = BlendOver4SSE2(_mm_loadu_si128((const __m128i*)(top + x)), frame4);
+        }
+        _mm_storeu_si128((__m128i*)(out + x), frame4);
+    }
+    ExpandBlendRowScalar(lut, idx + x, (top != nullptr) ? top + x : nullptr, out + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+// alpha = alpha * scale / 256, alpha and scale fit in the low 16bits of each pixel lane.
+LL_TARGET("sse2") static inline
+__m128i Decay4SSE2(__m128i pix, __m128i scale) {
+    __m128i alpha = _mm_srli_epi32(_mm_mullo_epi16(_mm_srli_epi32(pix, 24), scale), 8);
+    return _mm_or_si128(_mm_and_si128(pix, _mm_set1_epi32(0x00ffffff)), _mm_slli_epi32(alpha, 24));
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("sse2")
+static void DecayRowSSE2(FColor* row, unsigned scale, unsigned width) {
+    const __m128i scale4 = _mm_set1_epi32((int)scale);
+    unsigned x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i pix4 = _mm_loadu_si128((const __m128i*)(row + x));
+        _mm_storeu_si128((__m128i*)(row + x), Decay4SSE2(pix4, scale4));
+    }
+    DecayRowScalar(row + x, scale, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("sse2")
+static void DecayExpandBlendRowSSE2(const FColor* lut, const BYTE* idx, FColor* top, unsigned scale, FColor* out, unsigned width) {
+    const __m128i scale4 = _mm_set1_epi32((int)scale);
+    const int* lut32 = (const int*)lut;
+    unsigned x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i top4 = Decay4SSE2(_mm_loadu_si128((const __m128i*)(top + x)), scale4);
+        _mm_storeu_si128((__m128i*)(top + x), top4);
+        __m128i frame4 = _mm_setr_epi32(lut32[idx[x]], lut32[idx[x + 1]], lut32[idx[x + 2]], lut32[idx[x + 3]]);
+        _mm_storeu_si128((__m128i*)(out + x), BlendOver4SSE2(top4, frame4));
+    }
+    DecayExpandBlendRowScalar(lut, idx + x, top + x, scale, out + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("sse2")
+static void LutBlendOverRowSSE2(const FColor* lut, const BYTE* idx, FColor* bot, unsigned width) {
+    const int* lut32 = (const int*)lut;
+    unsigned x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i top4 = _mm_setr_epi32(lut32[idx[x]], lut32[idx[x + 1]], lut32[idx[x + 2]], lut32[idx[x + 3]]);
+        __m128i bot4 = _mm_loadu_si128((const __m128i*)(bot + x));
+        _mm_storeu_si128((__m128i*)(bot + x), BlendOver4SSE2(top4, bot4));
+    }
+    LutBlendOverRowScalar(lut, idx + x, bot + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("sse2")
+static void MaxRowSSE2(const BYTE* in, BYTE* out, unsigned width) {
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i in16 = _mm_loadu_si128((const __m128i*)(in + x));
+        __m128i out16 = _mm_loadu_si128((const __m128i*)(out + x));
+        _mm_storeu_si128((__m128i*)(out + x), _mm_max_epu8(in16, out16));
+    }
+    MaxRowScalar(in + x, out + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Premultiplied source over in 16bit lanes,  top + bot * (255 - top alpha) / 255
+LL_TARGET("sse2") static inline
+__m128i PremulOverHalfSSE2(__m128i top16, __m128i bot16) {
+    const __m128i v255 = _mm_set1_epi16(255);
+    const __m128i div255 = _mm_set1_epi16((short)0x8081);
+    __m128i inv = _mm_sub_epi16(v255, _mm_shufflehi_epi16(_mm_shufflelo_epi16(top16, 0xff), 0xff));
+    return _mm_add_epi16(top16, _mm_srli_epi16(_mm_mulhi_epu16(_mm_mullo_epi16(bot16, inv), div255), 7));
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("sse2") static inline
+__m128i PremulOver4SSE2(__m128i top, __m128i bot) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = PremulOverHalfSSE2(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bot, zero));
+    __m128i hi = PremulOverHalfSSE2(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bot, zero));
+    return _mm_packus_epi16(lo, hi);
+}
+
+// -------------------------------------------------------------------------------------------------
+// All four channels * scale / 256, scale in every 16bit lane.
+LL_TARGET("sse2") static inline
+__m128i PremulDecay4SSE2(__m128i pix, __m128i scale) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pix, zero), scale), 8);
+    __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pix, zero), scale), 8);
+    return _mm_packus_epi16(lo, hi);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("sse2")
+static void PremulLutOverRowSSE2(const FColor* lut, const BYTE* idx, FColor* bot, unsigned width) {
+    const int* lut32 = (const int*)lut;
+    unsigned x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i top4 = _mm_setr_epi32(lut32[idx[x]], lut32[idx[x + 1]], lut32[idx[x + 2]], lut32[idx[x + 3]]);
+        __m128i bot4 = _mm_loadu_si128((const __m128i*)(bot + x));
+        _mm_storeu_si128((__m128i*)(bot + x), PremulOver4SSE2(top4, bot4));
+    }
+    PremulLutOverRowScalar(lut, idx + x, bot + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("sse2")
+static void PremulDecayOverRowSSE2(const FColor* lut, const BYTE* idx, FColor* top, unsigned scale, FColor* out, unsigned width) {
+    const __m128i scale8 = _mm_set1_epi16((short)scale);
+    const int* lut32 = (const int*)lut;
+    unsigned x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i top4 = PremulDecay4SSE2(_mm_loadu_si128((const __m128i*)(top + x)), scale8);
+        _mm_storeu_si128((__m128i*)(top + x), top4);
+        __m128i frame4 = _mm_setr_epi32(lut32[idx[x]], lut32[idx[x + 1]], lut32[idx[x + 2]], lut32[idx[x + 3]]);
+        _mm_storeu_si128((__m128i*)(out + x), PremulOver4SSE2(top4, frame4));
+    }
+    PremulDecayOverRowScalar(lut, idx + x, top + x, scale, out + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Replace alpha byte of 4 pixels with the low 4 16bit lanes of alpha8.
+LL_TARGET("sse2") static inline
+__m128i SetAlpha4SSE2(__m128i pix, __m128i alpha8) {
+    __m128i alpha = _mm_slli_epi32(_mm_unpacklo_epi16(alpha8, _mm_setzero_si128()), 24);
+    return _mm_or_si128(_mm_and_si128(pix, _mm_set1_epi32(0x00ffffff)), alpha);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("sse2")
+static void DecayA16RowSSE2(WORD* alpha16, FColor* row, unsigned scale, unsigned width) {
+    const __m128i scale8 = _mm_set1_epi16((short)scale);
+    const __m128i round = _mm_set1_epi16(128);
+    unsigned x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m128i alpha = _mm_loadu_si128((const __m128i*)(alpha16 + x));
+        if (scale <= 0xffff) {
+            alpha = _mm_mulhi_epu16(alpha, scale8);
+            _mm_storeu_si128((__m128i*)(alpha16 + x), alpha);
+        }
+        __m128i alpha8 = _mm_srli_epi16(_mm_add_epi16(alpha, round), 8);
+        __m128i* pix = (__m128i*)(row + x);
+        _mm_storeu_si128(pix, SetAlpha4SSE2(_mm_loadu_si128(pix), alpha8));
+        _mm_storeu_si128(pix + 1, SetAlpha4SSE2(_mm_loadu_si128(pix + 1), _mm_srli_si128(alpha8, 8)));
+    }
+    DecayA16RowScalar(alpha16 + x, row + x, scale, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("sse2")
+static void LutBlendOverA16RowSSE2(const FColor* lut, const BYTE* idx, FColor* bot, WORD* alpha16, unsigned width) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alphaMask = _mm_set1_epi32((int)0xff000000);
+    const int* lut32 = (const int*)lut;
+    unsigned x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i top4 = _mm_setr_epi32(lut32[idx[x]], lut32[idx[x + 1]], lut32[idx[x + 2]], lut32[idx[x + 3]]);
+        __m128i bot4 = _mm_loadu_si128((const __m128i*)(bot + x));
+        __m128i out4 = BlendOver4SSE2(top4, bot4);
+        _mm_storeu_si128((__m128i*)(bot + x), out4);
+
+        // Written pixels take the new 8bit alpha, 16bit lanes are sign extended so packs keeps them.
+        __m128i topClear = _mm_cmpeq_epi32(_mm_and_si128(top4, alphaMask), zero);
+        __m128i botClear = _mm_cmpeq_epi32(_mm_and_si128(bot4, alphaMask), zero);
+        __m128i written = _mm_or_si128(_mm_xor_si128(topClear, _mm_set1_epi32(-1)), botClear);
+        __m128i alpha = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(alpha16 + x)), zero);
+        __m128i alphaNew = _mm_slli_epi32(_mm_srli_epi32(out4, 24), 8);
+        alpha = _mm_or_si128(_mm_and_si128(written, alphaNew), _mm_andnot_si128(written, alpha));
+        alpha = _mm_srai_epi32(_mm_slli_epi32(alpha, 16), 16);
+        _mm_storel_epi64((__m128i*)(alpha16 + x), _mm_packs_epi32(alpha, alpha));
+    }
+    LutBlendOverA16RowScalar(lut, idx + x, bot + x, alpha16 + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("sse2")
+static void DecayPlaneRowSSE2(BYTE* alpha, unsigned scale, unsigned width) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i scale8 = _mm_set1_epi16((short)scale);
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i alpha16 = _mm_loadu_si128((const __m128i*)(alpha + x));
+        __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(alpha16, zero), scale8), 8);
+        __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(alpha16, zero), scale8), 8);
+        _mm_storeu_si128((__m128i*)(alpha + x), _mm_packus_epi16(lo, hi));
+    }
+    DecayPlaneRowScalar(alpha + x, scale, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("sse2")
+static void InterleaveRowSSE2(const BYTE* blue, const BYTE* green, const BYTE* red, const BYTE* alpha, FColor* out, unsigned width) {
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i b = _mm_loadu_si128((const __m128i*)(blue + x));
+        __m128i g = _mm_loadu_si128((const __m128i*)(green + x));
+        __m128i r = _mm_loadu_si128((const __m128i*)(red + x));
+        __m128i a = _mm_loadu_si128((const __m128i*)(alpha + x));
+        __m128i bgLo = _mm_unpacklo_epi8(b, g);
+        __m128i bgHi = _mm_unpackhi_epi8(b, g);
+        __m128i raLo = _mm_unpacklo_epi8(r, a);
+        __m128i raHi = _mm_unpackhi_epi8(r, a);
+        __m128i* pix = (__m128i*)(out + x);
+        _mm_storeu_si128(pix, _mm_unpacklo_epi16(bgLo, raLo));
+        _mm_storeu_si128(pix + 1, _mm_unpackhi_epi16(bgLo, raLo));
+        _mm_storeu_si128(pix + 2, _mm_unpacklo_epi16(bgHi, raHi));
+        _mm_storeu_si128(pix + 3, _mm_unpackhi_epi16(bgHi, raHi));
+    }
+    InterleaveRowScalar(blue + x, green + x, red + x, alpha + x, out + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+// 16 pixel 4x16 byte transpose, three rounds of byte unpacks then 64bit unpacks.
+LL_TARGET("sse2")
+static void DeinterleaveRowSSE2(const FColor* in, BYTE* blue, BYTE* green, BYTE* red, BYTE* alpha, unsigned width) {
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        const __m128i* pix = (const __m128i*)(in + x);
+        __m128i v0 = _mm_loadu_si128(pix);
+        __m128i v1 = _mm_loadu_si128(pix + 1);
+        __m128i v2 = _mm_loadu_si128(pix + 2);
+        __m128i v3 = _mm_loadu_si128(pix + 3);
+        __m128i u0 = _mm_unpacklo_epi8(v0, v1);
+        __m128i u1 = _mm_unpackhi_epi8(v0, v1);
+        __m128i u2 = _mm_unpacklo_epi8(v2, v3);
+        __m128i u3 = _mm_unpackhi_epi8(v2, v3);
+        __m128i w0 = _mm_unpacklo_epi8(u0, u1);
+        __m128i w1 = _mm_unpackhi_epi8(u0, u1);
+        __m128i w2 = _mm_unpacklo_epi8(u2, u3);
+        __m128i w3 = _mm_unpackhi_epi8(u2, u3);
+        __m128i bg0 = _mm_unpacklo_epi8(w0, w1);     // blue 0..7, green 0..7
+        __m128i ra0 = _mm_unpackhi_epi8(w0, w1);     // red 0..7, alpha 0..7
+        __m128i bg1 = _mm_unpacklo_epi8(w2, w3);
+        __m128i ra1 = _mm_unpackhi_epi8(w2, w3);
+        _mm_storeu_si128((__m128i*)(blue + x), _mm_unpacklo_epi64(bg0, bg1));
+        _mm_storeu_si128((__m128i*)(green + x), _mm_unpackhi_epi64(bg0, bg1));
+        _mm_storeu_si128((__m128i*)(red + x), _mm_unpacklo_epi64(ra0, ra1));
+        _mm_storeu_si128((__m128i*)(alpha + x), _mm_unpackhi_epi64(ra0, ra1));
+    }
+    DeinterleaveRowScalar(in + x, blue + x, green + x, red + x, alpha + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Porter-Duff operator in 16bit lanes on straight alpha pixels. Premultiply (alpha lane kept),
+// then  (A * top + B * bot + C * top * bot) / 255  matching FColor::compositePremul.
+// Lane products may wrap, the true result is <= 65025 so the 16bit sum is exact.
+template <CompositeOp OP> LL_TARGET("sse2") static inline
+__m128i CompositeHalfSSE2(__m128i top16, __m128i bot16) {
+    const __m128i v255 = _mm_set1_epi16(255);
+    const __m128i div255 = _mm_set1_epi16((short)0x8081);
+    const __m128i colorMask = _mm_set1_epi64x(0x0000ffffffffffffLL);
+    const __m128i alphaLane = _mm_set1_epi64x(0x00ff000000000000LL);
+    __m128i topAlpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(top16, 0xff), 0xff);
+    __m128i botAlpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(bot16, 0xff), 0xff);
+    __m128i top = _mm_mullo_epi16(top16, _mm_or_si128(_mm_and_si128(topAlpha, colorMask), alphaLane));
+    __m128i bot = _mm_mullo_epi16(bot16, _mm_or_si128(_mm_and_si128(botAlpha, colorMask), alphaLane));
+    top = _mm_srli_epi16(_mm_mulhi_epu16(top, div255), 7);
+    bot = _mm_srli_epi16(_mm_mulhi_epu16(bot, div255), 7);
+    if (OP == COMPOSITE_PLUS)
+        return _mm_add_epi16(top, bot);     // packus saturates
+
+    __m128i sum;
+    if (OP == COMPOSITE_OVER || OP == COMPOSITE_SCREEN)
+        sum = _mm_mullo_epi16(top, v255);
+    else if (OP == COMPOSITE_IN || OP == COMPOSITE_ATOP)
+        sum = _mm_mullo_epi16(top, botAlpha);
+    else
+        sum = _mm_mullo_epi16(top, _mm_sub_epi16(v255, botAlpha));
+    if (OP == COMPOSITE_SCREEN)
+        sum = _mm_add_epi16(sum, _mm_mullo_epi16(bot, v255));
+    else if (OP != COMPOSITE_IN && OP != COMPOSITE_OUT)
+        sum = _mm_add_epi16(sum, _mm_mullo_epi16(bot, _mm_sub_epi16(v255, topAlpha)));
+    if (OP == COMPOSITE_MULTIPLY)
+        sum = _mm_add_epi16(sum, _mm_mullo_epi16(top, bot));
+    else if (OP == COMPOSITE_SCREEN)
+        sum = _mm_sub_epi16(sum, _mm_mullo_epi16(top, bot));
+    return _mm_srli_epi16(_mm_mulhi_epu16(sum, div255), 7);
+}
+
+// -------------------------------------------------------------------------------------------------
+template <CompositeOp OP> LL_TARGET("sse2")
+static void CompositePremulRowSSE2(const FColor* top, const FColor* bot, FColor* out, unsigned width) {
+    const __m128i zero = _mm_setzero_si128();
+    unsigned x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i top4 = _mm_loadu_si128((const __m128i*)(top + x));
+        __m128i bot4 = _mm_loadu_si128((const __m128i*)(bot + x));
+        __m128i lo = CompositeHalfSSE2<OP>(_mm_unpacklo_epi8(top4, zero), _mm_unpacklo_epi8(bot4, zero));
+        __m128i hi = CompositeHalfSSE2<OP>(_mm_unpackhi_epi8(top4, zero), _mm_unpackhi_epi8(bot4, zero));
+        _mm_storeu_si128((__m128i*)(out + x), _mm_packus_epi16(lo, hi));
+    }
+    CompositePremulRowScalar<OP>(top + x, bot + x, out + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+template <CompositeOp OP> LL_TARGET("sse2")
+static void CompositeRowSSE2(const FColor* top, const FColor* bot, FColor* out, unsigned width) {
+    CompositePremulRowSSE2<OP>(top, bot, out, width);
+    StraightRowScalar(out, width);
+}
+
+static const FKernel::CompositeRowFn CompositeRowsSSE2[COMPOSITE_OPS] = {
+    CompositeRowSSE2<COMPOSITE_OVER>, CompositeRowSSE2<COMPOSITE_IN>,
+    CompositeRowSSE2<COMPOSITE_OUT>, CompositeRowSSE2<COMPOSITE_ATOP>,
+    CompositeRowSSE2<COMPOSITE_XOR>, CompositeRowSSE2<COMPOSITE_PLUS>,
+    CompositeRowSSE2<COMPOSITE_MULTIPLY>, CompositeRowSSE2<COMPOSITE_SCREEN>
+};
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx2") static inline
+__m256i MixHalfAVX2(__m256i top16, __m256i bot16) {
+    const __m256i v255 = _mm256_set1_epi16(255);
+    const __m256i div255 = _mm256_set1_epi16((short)0x8081);
+    __m256i alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(top16, 0xff), 0xff);
+    __m256i sum = _mm256_add_epi16(
+        _mm256_mullo_epi16(top16, alpha),
+        _mm256_mullo_epi16(bot16, _mm256_sub_epi16(v255, alpha)));
+    return _mm256_srli_epi16(_mm256_mulhi_epu16(sum, div255), 7);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx2") static inline
+__m256i BlendOver8AVX2(__m256i top, __m256i bot) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alphaMask = _mm256_set1_epi32((int)0xff000000);
+
+    // unpack/pack work per 128bit lane, so pixel order is preserved.
+    __m256i lo = MixHalfAVX2(_mm256_unpacklo_epi8(top, zero), _mm256_unpacklo_epi8(bot, zero));
+    __m256i hi = MixHalfAVX2(_mm256_unpackhi_epi8(top, zero), _mm256_unpackhi_epi8(bot, zero));
+    __m256i mix = _mm256_or_si256(_mm256_packus_epi16(lo, hi), alphaMask);
+
+    __m256i topClear = _mm256_cmpeq_epi32(_mm256_and_si256(top, alphaMask), zero);
+    __m256i botClear = _mm256_cmpeq_epi32(_mm256_and_si256(bot, alphaMask), zero);
+    __m256i out = _mm256_blendv_epi8(mix, bot, topClear);
+    return _mm256_blendv_epi8(out, top, botClear);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx2")
+static void BlendOverRowAVX2(const FColor* top, FColor* bot, unsigned width) {
+    const __m256i alphaMask = _mm256_set1_epi32((int)0xff000000);
+    unsigned x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i top8 = _mm256_loadu_si256((const __m256i*)(top + x));
+        __m256i bot8 = _mm256_loadu_si256((const __m256i*)(bot + x));
+        if (_mm256_testz_si256(top8, alphaMask)) {
+            __m256i botClear = _mm256_cmpeq_epi32(_mm256_and_si256(bot8, alphaMask), _mm256_setzero_si256());
+            if (! _mm256_testz_si256(botClear, botClear))
+                _mm256_storeu_si256((__m256i*)(bot + x), _mm256_blendv_epi8(bot8, top8, botClear));
+            continue;
+        }
+        _mm256_storeu_si256((__m256i*)(bot + x), BlendOver8AVX2(top8, bot8));
+    }
+    BlendOverRowSSE2(top + x, bot + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx2")
+static void ExpandBlendRowAVX2(const FColor* lut, const BYTE* idx, const FColor* top, FColor* out, unsigned width) {
+    unsigned x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i idx8 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(idx + x)));
+        __m256i frame8 = _mm256_i32gather_epi32((const int*)lut, idx8, 4);
+        if (top != nullptr) {
+            frame8 = BlendOver8AVX2(_mm256_loadu_si256((const __m256i*)(top + x)), frame8);
+        }
+        _mm256_storeu_si256((__m256i*)(out + x), frame8);
+    }
+    ExpandBlendRowSSE2(lut, idx + x, (top != nullptr) ? top + x : nullptr, out + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx2") static inline
+__m256i Decay8AVX2(__m256i pix, __m256i scale) {
+    __m256i alpha = _mm256_srli_epi32(_mm256_mullo_epi16(_mm256_srli_epi32(pix, 24), scale), 8);
+    return _mm256_or_si256(_mm256_and_si256(pix, _mm256_set1_epi32(0x00ffffff)), _mm256_slli_epi32(alpha, 24));
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx2")
+static void DecayRowAVX2(FColor* row, unsigned scale, unsigned width) {
+    const __m256i scale8 = _mm256_set1_epi32((int)scale);
+    unsigned x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i pix8 = _mm256_loadu_si256((const __m256i*)(row + x));
+        _mm256_storeu_si256((__m256i*)(row + x), Decay8AVX2(pix8, scale8));
+    }
+    DecayRowSSE2(row + x, scale, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx2")
+static void DecayExpandBlendRowAVX2(const FColor* lut, const BYTE* idx, FColor* top, unsigned scale, FColor* out, unsigned width) {
+    const __m256i scale8 = _mm256_set1_epi32((int)scale);
+    unsigned x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i top8 = Decay8AVX2(_mm256_loadu_si256((const __m256i*)(top + x)), scale8);
+        _mm256_storeu_si256((__m256i*)(top + x), top8);
+        __m256i idx8 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(idx + x)));
+        __m256i frame8 = _mm256_i32gather_epi32((const int*)lut, idx8, 4);
+        _mm256_storeu_si256((__m256i*)(out + x), BlendOver8AVX2(top8, frame8));
+    }
+    DecayExpandBlendRowSSE2(lut, idx + x, top + x, scale, out + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx2")
+static void LutBlendOverRowAVX2(const FColor* lut, const BYTE* idx, FColor* bot, unsigned width) {
+    unsigned x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i idx8 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(idx + x)));
+        __m256i top8 = _mm256_i32gather_epi32((const int*)lut, idx8, 4);
+        __m256i bot8 = _mm256_loadu_si256((const __m256i*)(bot + x));
+        _mm256_storeu_si256((__m256i*)(bot + x), BlendOver8AVX2(top8, bot8));
+    }
+    LutBlendOverRowSSE2(lut, idx + x, bot + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx2")
+static void MaxRowAVX2(const BYTE* in, BYTE* out, unsigned width) {
+    unsigned x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i in32 = _mm256_loadu_si256((const __m256i*)(in + x));
+        __m256i out32 = _mm256_loadu_si256((const __m256i*)(out + x));
+        _mm256_storeu_si256((__m256i*)(out + x), _mm256_max_epu8(in32, out32));
+    }
+    MaxRowSSE2(in + x, out + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx2") static inline
+__m256i PremulOverHalfAVX2(__m256i top16, __m256i bot16) {
+    const __m256i v255 = _mm256_set1_epi16(255);
+    const __m256i div255 = _mm256_set1_epi16((short)0x8081);
+    __m256i inv = _mm256_sub_epi16(v255, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(top16, 0xff), 0xff));
+    return _mm256_add_epi16(top16, _mm256_srli_epi16(_mm256_mulhi_epu16(_mm256_mullo_epi16(bot16, inv), div255), 7));
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx2") static inline
+__m256i PremulOver8AVX2(__m256i top, __m256i bot) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i lo = PremulOverHalfAVX2(_mm256_unpacklo_epi8(top, zero), _mm256_unpacklo_epi8(bot, zero));
+    __m256i hi = PremulOverHalfAVX2(_mm256_unpackhi_epi8(top, zero), _mm256_unpackhi_epi8(bot, zero));
+    return _mm256_packus_epi16(lo, hi);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx2") static inline
+__m256i PremulDecay8AVX2(__m256i pix, __m256i scale) {
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i lo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(pix, zero), scale), 8);
+    __m256i hi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(pix, zero), scale), 8);
+    return _mm256_packus_epi16(lo, hi);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx2")
+static void PremulLutOverRowAVX2(const FColor* lut, const BYTE* idx, FColor* bot, unsigned width) {
+    unsigned x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i idx8 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(idx + x)));
+        __m256i top8 = _mm256_i32gather_epi32((const int*)lut, idx8, 4);
+        __m256i bot8 = _mm256_loadu_si256((const __m256i*)(bot + x));
+        _mm256_storeu_si256((__m256i*)(bot + x), PremulOver8AVX2(top8, bot8));
+    }
+    PremulLutOverRowSSE2(lut, idx + x, bot + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx2")
+static void PremulDecayOverRowAVX2(const FColor* lut, const BYTE* idx, FColor* top, unsigned scale, FColor* out, unsigned width) {
+    const __m256i scale16 = _mm256_set1_epi16((short)scale);
+    unsigned x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i top8 = PremulDecay8AVX2(_mm256_loadu_si256((const __m256i*)(top + x)), scale16);
+        _mm256_storeu_si256((__m256i*)(top + x), top8);
+        __m256i idx8 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(idx + x)));
+        __m256i frame8 = _mm256_i32gather_epi32((const int*)lut, idx8, 4);
+        _mm256_storeu_si256((__m256i*)(out + x), PremulOver8AVX2(top8, frame8));
+    }
+    PremulDecayOverRowSSE2(lut, idx + x, top + x, scale, out + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Straight alpha in 32bit lanes,  min(255, (c * reciprocal255[alpha] + 0x8000) >> 16)
+LL_TARGET("avx2")
+static void StraightRowAVX2(FColor* row, unsigned width) {
+    const int* recip = (const int*)FColor::reciprocal255();
+    const __m256i mask = _mm256_set1_epi32(0xff);
+    const __m256i round = _mm256_set1_epi32(0x8000);
+    unsigned x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i pix8 = _mm256_loadu_si256((const __m256i*)(row + x));
+        __m256i recip8 = _mm256_i32gather_epi32(recip, _mm256_srli_epi32(pix8, 24), 4);
+        __m256i blue = _mm256_and_si256(pix8, mask);
+        __m256i green = _mm256_and_si256(_mm256_srli_epi32(pix8, 8), mask);
+        __m256i red = _mm256_and_si256(_mm256_srli_epi32(pix8, 16), mask);
+        blue = _mm256_min_epu32(_mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(blue, recip8), round), 16), mask);
+        green = _mm256_min_epu32(_mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(green, recip8), round), 16), mask);
+        red = _mm256_min_epu32(_mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(red, recip8), round), 16), mask);
+        __m256i out8 = _mm256_andnot_si256(_mm256_set1_epi32(0x00ffffff), pix8);
+        out8 = _mm256_or_si256(out8, _mm256_or_si256(blue, _mm256_or_si256(_mm256_slli_epi32(green, 8), _mm256_slli_epi32(red, 16))));
+        _mm256_storeu_si256((__m256i*)(row + x), out8);
+    }
+    StraightRowScalar(row + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx2")
+static void DecayA16RowAVX2(WORD* alpha16, FColor* row, unsigned scale, unsigned width) {
+    const __m256i scale16 = _mm256_set1_epi16((short)scale);
+    const __m256i round = _mm256_set1_epi16(128);
+    const __m256i colorMask = _mm256_set1_epi32(0x00ffffff);
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i alpha = _mm256_loadu_si256((const __m256i*)(alpha16 + x));
+        if (scale <= 0xffff) {
+            alpha = _mm256_mulhi_epu16(alpha, scale16);
+            _mm256_storeu_si256((__m256i*)(alpha16 + x), alpha);
+        }
+        __m256i alpha8 = _mm256_srli_epi16(_mm256_add_epi16(alpha, round), 8);
+        __m256i lo = _mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(alpha8)), 24);
+        __m256i hi = _mm256_slli_epi32(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(alpha8, 1)), 24);
+        __m256i* pix = (__m256i*)(row + x);
+        _mm256_storeu_si256(pix, _mm256_or_si256(_mm256_and_si256(_mm256_loadu_si256(pix), colorMask), lo));
+        _mm256_storeu_si256(pix + 1, _mm256_or_si256(_mm256_and_si256(_mm256_loadu_si256(pix + 1), colorMask), hi));
+    }
+    DecayA16RowSSE2(alpha16 + x, row + x, scale, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx2")
+static void LutBlendOverA16RowAVX2(const FColor* lut, const BYTE* idx, FColor* bot, WORD* alpha16, unsigned width) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alphaMask = _mm256_set1_epi32((int)0xff000000);
+    unsigned x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i idx8 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(idx + x)));
+        __m256i top8 = _mm256_i32gather_epi32((const int*)lut, idx8, 4);
+        __m256i bot8 = _mm256_loadu_si256((const __m256i*)(bot + x));
+        __m256i out8 = BlendOver8AVX2(top8, bot8);
+        _mm256_storeu_si256((__m256i*)(bot + x), out8);
+
+        __m256i topClear = _mm256_cmpeq_epi32(_mm256_and_si256(top8, alphaMask), zero);
+        __m256i botClear = _mm256_cmpeq_epi32(_mm256_and_si256(bot8, alphaMask), zero);
+        __m256i written = _mm256_or_si256(_mm256_xor_si256(topClear, _mm256_set1_epi32(-1)), botClear);
+        __m256i alpha = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(alpha16 + x)));
+        __m256i alphaNew = _mm256_slli_epi32(_mm256_srli_epi32(out8, 24), 8);
+        alpha = _mm256_blendv_epi8(alpha, alphaNew, written);
+        alpha = _mm256_permute4x64_epi64(_mm256_packus_epi32(alpha, alpha), 0x08);
+        _mm_storeu_si128((__m128i*)(alpha16 + x), _mm256_castsi256_si128(alpha));
+    }
+    LutBlendOverA16RowSSE2(lut, idx + x, bot + x, alpha16 + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx2")
+static void DecayPlaneRowAVX2(BYTE* alpha, unsigned scale, unsigned width) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i scale16 = _mm256_set1_epi16((short)scale);
+    unsigned x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i alpha32 = _mm256_loadu_si256((const __m256i*)(alpha + x));
+        __m256i lo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(alpha32, zero), scale16), 8);
+        __m256i hi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(alpha32, zero), scale16), 8);
+        _mm256_storeu_si256((__m256i*)(alpha + x), _mm256_packus_epi16(lo, hi));
+    }
+    DecayPlaneRowSSE2(alpha + x, scale, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Unpacks stay in 128bit lanes, permute2x128 puts the pixels back in order.
+LL_TARGET("avx2")
+static void InterleaveRowAVX2(const BYTE* blue, const BYTE* green, const BYTE* red, const BYTE* alpha, FColor* out, unsigned width) {
+    unsigned x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i b = _mm256_loadu_si256((const __m256i*)(blue + x));
+        __m256i g = _mm256_loadu_si256((const __m256i*)(green + x));
+        __m256i r = _mm256_loadu_si256((const __m256i*)(red + x));
+        __m256i a = _mm256_loadu_si256((const __m256i*)(alpha + x));
+        __m256i bgLo = _mm256_unpacklo_epi8(b, g);
+        __m256i bgHi = _mm256_unpackhi_epi8(b, g);
+        __m256i raLo = _mm256_unpacklo_epi8(r, a);
+        __m256i raHi = _mm256_unpackhi_epi8(r, a);
+        __m256i p0 = _mm256_unpacklo_epi16(bgLo, raLo);     // pixels 0..3, 16..19
+        __m256i p1 = _mm256_unpackhi_epi16(bgLo, raLo);     // pixels 4..7, 20..23
+        __m256i p2 = _mm256_unpacklo_epi16(bgHi, raHi);     // pixels 8..11, 24..27
+        __m256i p3 = _mm256_unpackhi_epi16(bgHi, raHi);     // pixels 12..15, 28..31
+        __m256i* pix = (__m256i*)(out + x);
+        _mm256_storeu_si256(pix, _mm256_permute2x128_si256(p0, p1, 0x20));
+        _mm256_storeu_si256(pix + 1, _mm256_permute2x128_si256(p2, p3, 0x20));
+        _mm256_storeu_si256(pix + 2, _mm256_permute2x128_si256(p0, p1, 0x31));
+        _mm256_storeu_si256(pix + 3, _mm256_permute2x128_si256(p2, p3, 0x31));
+    }
+    InterleaveRowSSE2(blue + x, green + x, red + x, alpha + x, out + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Byte shuffle groups channels in each 128bit lane, dword permute joins the lanes.
+LL_TARGET("avx2")
+static void DeinterleaveRowAVX2(const FColor* in, BYTE* blue, BYTE* green, BYTE* red, BYTE* alpha, unsigned width) {
+    const __m256i group = _mm256_setr_epi8(
+        0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+        0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+    const __m256i join = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    unsigned x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i pix8 = _mm256_loadu_si256((const __m256i*)(in + x));
+        __m256i planes = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(pix8, group), join);
+        __m128i bg = _mm256_castsi256_si128(planes);
+        __m128i ra = _mm256_extracti128_si256(planes, 1);
+        _mm_storel_epi64((__m128i*)(blue + x), bg);
+        _mm_storel_epi64((__m128i*)(green + x), _mm_unpackhi_epi64(bg, bg));
+        _mm_storel_epi64((__m128i*)(red + x), ra);
+        _mm_storel_epi64((__m128i*)(alpha + x), _mm_unpackhi_epi64(ra, ra));
+    }
+    DeinterleaveRowSSE2(in + x, blue + x, green + x, red + x, alpha + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+// FColor::blendOverLinear for 8 pixels, per channel gathers from the linear light tables.
+LL_TARGET("avx2") static inline
+__m256i BlendOverLinear8AVX2(__m256i top, __m256i bot, const WORD* lin, const BYTE* srgb) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i alphaMask = _mm256_set1_epi32((int)0xff000000);
+    const __m256i byteMask = _mm256_set1_epi32(0xff);
+    const __m256i wordMask = _mm256_set1_epi32(0xffff);
+    __m256i topClear = _mm256_cmpeq_epi32(_mm256_and_si256(top, alphaMask), zero);
+    __m256i botClear = _mm256_cmpeq_epi32(_mm256_and_si256(bot, alphaMask), zero);
+    if (_mm256_movemask_epi8(_mm256_or_si256(topClear, botClear)) == -1) {
+        return _mm256_blendv_epi8(bot, top, botClear);
+    }
+
+    __m256i alpha = _mm256_srli_epi32(top, 24);
+    __m256i inv = _mm256_sub_epi32(byteMask, alpha);
+    __m256i mix = alphaMask;
+    for (int shift = 0; shift < 24; shift += 8) {
+        __m128i count = _mm_cvtsi32_si128(shift);
+        __m256i topLin = _mm256_i32gather_epi32((const int*)lin, _mm256_and_si256(_mm256_srl_epi32(top, count), byteMask), 2);
+        __m256i botLin = _mm256_i32gather_epi32((const int*)lin, _mm256_and_si256(_mm256_srl_epi32(bot, count), byteMask), 2);
+        __m256i sum = _mm256_add_epi32(
+            _mm256_mullo_epi32(_mm256_and_si256(topLin, wordMask), alpha),
+            _mm256_mullo_epi32(_mm256_and_si256(botLin, wordMask), inv));
+        __m256i value = _mm256_i32gather_epi32((const int*)srgb, _mm256_srli_epi32(sum, FColor::LINEAR_SHIFT), 1);
+        mix = _mm256_or_si256(mix, _mm256_sll_epi32(_mm256_and_si256(value, byteMask), count));
+    }
+
+    __m256i out = _mm256_blendv_epi8(mix, bot, topClear);
+    return _mm256_blendv_epi8(out, top, botClear);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx2")
+static void BlendOverLinearRowAVX2(const FColor* top, FColor* bot, unsigned width) {
+    const WORD* lin = FColor::srgbToLinear();
+    const BYTE* srgb = FColor::linearToSrgb();
+    unsigned x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i top8 = _mm256_loadu_si256((const __m256i*)(top + x));
+        __m256i bot8 = _mm256_loadu_si256((const __m256i*)(bot + x));
+        _mm256_storeu_si256((__m256i*)(bot + x), BlendOverLinear8AVX2(top8, bot8, lin, srgb));
+    }
+    BlendOverLinearRowScalar(top + x, bot + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx2")
+static void ExpandBlendLinearRowAVX2(const FColor* lut, const BYTE* idx, const FColor* top, FColor* out, unsigned width) {
+    if (top == nullptr) {
+        ExpandBlendRowAVX2(lut, idx, top, out, width);
+        return;
+    }
+    const WORD* lin = FColor::srgbToLinear();
+    const BYTE* srgb = FColor::linearToSrgb();
+    unsigned x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i idx8 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(idx + x)));
+        __m256i frame8 = _mm256_i32gather_epi32((const int*)lut, idx8, 4);
+        __m256i top8 = _mm256_loadu_si256((const __m256i*)(top + x));
+        _mm256_storeu_si256((__m256i*)(out + x), BlendOverLinear8AVX2(top8, frame8, lin, srgb));
+    }
+    ExpandBlendLinearRowScalar(lut, idx + x, top + x, out + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx2")
+static void DecayExpandBlendLinearRowAVX2(const FColor* lut, const BYTE* idx, FColor* top, unsigned scale, FColor* out, unsigned width) {
+    const WORD* lin = FColor::srgbToLinear();
+    const BYTE* srgb = FColor::linearToSrgb();
+    const __m256i scale8 = _mm256_set1_epi32((int)scale);
+    unsigned x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i top8 = Decay8AVX2(_mm256_loadu_si256((const __m256i*)(top + x)), scale8);
+        _mm256_storeu_si256((__m256i*)(top + x), top8);
+        __m256i idx8 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(idx + x)));
+        __m256i frame8 = _mm256_i32gather_epi32((const int*)lut, idx8, 4);
+        _mm256_storeu_si256((__m256i*)(out + x), BlendOverLinear8AVX2(top8, frame8, lin, srgb));
+    }
+    DecayExpandBlendLinearRowScalar(lut, idx + x, top + x, scale, out + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx2")
+static void LutBlendOverLinearRowAVX2(const FColor* lut, const BYTE* idx, FColor* bot, unsigned width) {
+    const WORD* lin = FColor::srgbToLinear();
+    const BYTE* srgb = FColor::linearToSrgb();
+    unsigned x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i idx8 = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(idx + x)));
+        __m256i top8 = _mm256_i32gather_epi32((const int*)lut, idx8, 4);
+        __m256i bot8 = _mm256_loadu_si256((const __m256i*)(bot + x));
+        _mm256_storeu_si256((__m256i*)(bot + x), BlendOverLinear8AVX2(top8, bot8, lin, srgb));
+    }
+    LutBlendOverLinearRowScalar(lut, idx + x, bot + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Porter-Duff operator in 16bit lanes on straight alpha pixels. Premultiply (alpha lane kept),
+// then  (A * top + B * bot + C * top * bot) / 255  matching FColor::compositePremul.
+// Lane products may wrap, the true result is <= 65025 so the 16bit sum is exact.
+template <CompositeOp OP> LL_TARGET("avx2") static inline
+__m256i CompositeHalfAVX2(__m256i top16, __m256i bot16) {
+    const __m256i v255 = _mm256_set1_epi16(255);
+    const __m256i div255 = _mm256_set1_epi16((short)0x8081);
+    const __m256i colorMask = _mm256_set1_epi64x(0x0000ffffffffffffLL);
+    const __m256i alphaLane = _mm256_set1_epi64x(0x00ff000000000000LL);
+    __m256i topAlpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(top16, 0xff), 0xff);
+    __m256i botAlpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(bot16, 0xff), 0xff);
+    __m256i top = _mm256_mullo_epi16(top16, _mm256_or_si256(_mm256_and_si256(topAlpha, colorMask), alphaLane));
+    __m256i bot = _mm256_mullo_epi16(bot16, _mm256_or_si256(_mm256_and_si256(botAlpha, colorMask), alphaLane));
+    top = _mm256_srli_epi16(_mm256_mulhi_epu16(top, div255), 7);
+    bot = _mm256_srli_epi16(_mm256_mulhi_epu16(bot, div255), 7);
+    if (OP == COMPOSITE_PLUS)
+        return _mm256_add_epi16(top, bot);     // packus saturates
+
+    __m256i sum;
+    if (OP == COMPOSITE_OVER || OP == COMPOSITE_SCREEN)
+        sum = _mm256_mullo_epi16(top, v255);
+    else if (OP == COMPOSITE_IN || OP == COMPOSITE_ATOP)
+        sum = _mm256_mullo_epi16(top, botAlpha);
+    else
+        sum = _mm256_mullo_epi16(top, _mm256_sub_epi16(v255, botAlpha));
+    if (OP == COMPOSITE_SCREEN)
+        sum = _mm256_add_epi16(sum, _mm256_mullo_epi16(bot, v255));
+    else if (OP != COMPOSITE_IN && OP != COMPOSITE_OUT)
+        sum = _mm256_add_epi16(sum, _mm256_mullo_epi16(bot, _mm256_sub_epi16(v255, topAlpha)));
+    if (OP == COMPOSITE_MULTIPLY)
+        sum = _mm256_add_epi16(sum, _mm256_mullo_epi16(top, bot));
+    else if (OP == COMPOSITE_SCREEN)
+        sum = _mm256_sub_epi16(sum, _mm256_mullo_epi16(top, bot));
+    return _mm256_srli_epi16(_mm256_mulhi_epu16(sum, div255), 7);
+}
+
+// -------------------------------------------------------------------------------------------------
+template <CompositeOp OP> LL_TARGET("avx2")
+static void CompositePremulRowAVX2(const FColor* top, const FColor* bot, FColor* out, unsigned width) {
+    const __m256i zero = _mm256_setzero_si256();
+    unsigned x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i top8 = _mm256_loadu_si256((const __m256i*)(top + x));
+        __m256i bot8 = _mm256_loadu_si256((const __m256i*)(bot + x));
+        __m256i lo = CompositeHalfAVX2<OP>(_mm256_unpacklo_epi8(top8, zero), _mm256_unpacklo_epi8(bot8, zero));
+        __m256i hi = CompositeHalfAVX2<OP>(_mm256_unpackhi_epi8(top8, zero), _mm256_unpackhi_epi8(bot8, zero));
+        _mm256_storeu_si256((__m256i*)(out + x), _mm256_packus_epi16(lo, hi));
+    }
+    CompositePremulRowSSE2<OP>(top + x, bot + x, out + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+template <CompositeOp OP> LL_TARGET("avx2")
+static void CompositeRowAVX2(const FColor* top, const FColor* bot, FColor* out, unsigned width) {
+    CompositePremulRowAVX2<OP>(top, bot, out, width);
+    StraightRowAVX2(out, width);
+}
+
+static const FKernel::CompositeRowFn CompositeRowsAVX2[COMPOSITE_OPS] = {
+    CompositeRowAVX2<COMPOSITE_OVER>, CompositeRowAVX2<COMPOSITE_IN>,
+    CompositeRowAVX2<COMPOSITE_OUT>, CompositeRowAVX2<COMPOSITE_ATOP>,
+    CompositeRowAVX2<COMPOSITE_XOR>, CompositeRowAVX2<COMPOSITE_PLUS>,
+    CompositeRowAVX2<COMPOSITE_MULTIPLY>, CompositeRowAVX2<COMPOSITE_SCREEN>
+};
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx512f,avx512bw") static inline
+__m512i MixHalfAVX512(__m512i top16, __m512i bot16) {
+    const __m512i v255 = _mm512_set1_epi16(255);
+    const __m512i div255 = _mm512_set1_epi16((short)0x8081);
+    __m512i alpha = _mm512_shufflehi_epi16(_mm512_shufflelo_epi16(top16, 0xff), 0xff);
+    __m512i sum = _mm512_add_epi16(
+        _mm512_mullo_epi16(top16, alpha),
+        _mm512_mullo_epi16(bot16, _mm512_sub_epi16(v255, alpha)));
+    return _mm512_srli_epi16(_mm512_mulhi_epu16(sum, div255), 7);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx512f,avx512bw") static inline
+__m512i BlendOver16AVX512(__m512i top, __m512i bot, __mmask16 topClear) {
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i alphaMask = _mm512_set1_epi32((int)0xff000000);
+
+    __m512i lo = MixHalfAVX512(_mm512_unpacklo_epi8(top, zero), _mm512_unpacklo_epi8(bot, zero));
+    __m512i hi = MixHalfAVX512(_mm512_unpackhi_epi8(top, zero), _mm512_unpackhi_epi8(bot, zero));
+    __m512i mix = _mm512_or_si512(_mm512_packus_epi16(lo, hi), alphaMask);
+
+    __mmask16 botClear = _mm512_testn_epi32_mask(bot, alphaMask);
+    __m512i out = _mm512_mask_blend_epi32(topClear, mix, bot);
+    return _mm512_mask_blend_epi32(botClear, out, top);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx512f,avx512bw")
+static void BlendOverRowAVX512(const FColor* top, FColor* bot, unsigned width) {
+    const __m512i alphaMask = _mm512_set1_epi32((int)0xff000000);
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m512i top16 = _mm512_loadu_si512((const void*)(top + x));
+        __m512i bot16 = _mm512_loadu_si512((const void*)(bot + x));
+        __mmask16 topClear = _mm512_testn_epi32_mask(top16, alphaMask);
+        if (topClear == 0xffff) {
+            __mmask16 botClear = _mm512_testn_epi32_mask(bot16, alphaMask);
+            if (botClear != 0)
+                _mm512_mask_storeu_epi32((void*)(bot + x), botClear, top16);
+            continue;
+        }
+        _mm512_storeu_si512((void*)(bot + x), BlendOver16AVX512(top16, bot16, topClear));
+    }
+    BlendOverRowAVX2(top + x, bot + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx512f,avx512bw")
+static void ExpandBlendRowAVX512(const FColor* lut, const BYTE* idx, const FColor* top, FColor* out, unsigned width) {
+    const __m512i alphaMask = _mm512_set1_epi32((int)0xff000000);
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m512i idx16 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(idx + x)));
+        __m512i frame16 = _mm512_i32gather_epi32(idx16, (const void*)lut, 4);
+        if (top != nullptr) {
+            __m512i top16 = _mm512_loadu_si512((const void*)(top + x));
+            frame16 = BlendOver16AVX512(top16, frame16, _mm512_testn_epi32_mask(top16, alphaMask));
+        }
+        _mm512_storeu_si512((void*)(out + x), frame16);
+    }
+    ExpandBlendRowAVX2(lut, idx + x, (top != nullptr) ? top + x : nullptr, out + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx512f,avx512bw") static inline
+__m512i Decay16AVX512(__m512i pix, __m512i scale) {
+    __m512i alpha = _mm512_srli_epi32(_mm512_mullo_epi16(_mm512_srli_epi32(pix, 24), scale), 8);
+    return _mm512_or_si512(_mm512_and_si512(pix, _mm512_set1_epi32(0x00ffffff)), _mm512_slli_epi32(alpha, 24));
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx512f,avx512bw")
+static void DecayRowAVX512(FColor* row, unsigned scale, unsigned width) {
+    const __m512i scale16 = _mm512_set1_epi32((int)scale);
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m512i pix16 = _mm512_loadu_si512((const void*)(row + x));
+        _mm512_storeu_si512((void*)(row + x), Decay16AVX512(pix16, scale16));
+    }
+    DecayRowAVX2(row + x, scale, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx512f,avx512bw")
+static void DecayExpandBlendRowAVX512(const FColor* lut, const BYTE* idx, FColor* top, unsigned scale, FColor* out, unsigned width) {
+    const __m512i alphaMask = _mm512_set1_epi32((int)0xff000000);
+    const __m512i scale16 = _mm512_set1_epi32((int)scale);
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m512i top16 = Decay16AVX512(_mm512_loadu_si512((const void*)(top + x)), scale16);
+        _mm512_storeu_si512((void*)(top + x), top16);
+        __m512i idx16 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(idx + x)));
+        __m512i frame16 = _mm512_i32gather_epi32(idx16, (const void*)lut, 4);
+        frame16 = BlendOver16AVX512(top16, frame16, _mm512_testn_epi32_mask(top16, alphaMask));
+        _mm512_storeu_si512((void*)(out + x), frame16);
+    }
+    DecayExpandBlendRowAVX2(lut, idx + x, top + x, scale, out + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx512f,avx512bw")
+static void LutBlendOverRowAVX512(const FColor* lut, const BYTE* idx, FColor* bot, unsigned width) {
+    const __m512i alphaMask = _mm512_set1_epi32((int)0xff000000);
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m512i idx16 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(idx + x)));
+        __m512i top16 = _mm512_i32gather_epi32(idx16, (const void*)lut, 4);
+        __m512i bot16 = _mm512_loadu_si512((const void*)(bot + x));
+        bot16 = BlendOver16AVX512(top16, bot16, _mm512_testn_epi32_mask(top16, alphaMask));
+        _mm512_storeu_si512((void*)(bot + x), bot16);
+    }
+    LutBlendOverRowAVX2(lut, idx + x, bot + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx512f,avx512bw")
+static void MaxRowAVX512(const BYTE* in, BYTE* out, unsigned width) {
+    unsigned x = 0;
+    for (; x + 64 <= width; x += 64) {
+        __m512i in64 = _mm512_loadu_si512((const void*)(in + x));
+        __m512i out64 = _mm512_loadu_si512((const void*)(out + x));
+        _mm512_storeu_si512((void*)(out + x), _mm512_max_epu8(in64, out64));
+    }
+    MaxRowAVX2(in + x, out + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx512f,avx512bw") static inline
+__m512i PremulOverHalfAVX512(__m512i top16, __m512i bot16) {
+    const __m512i v255 = _mm512_set1_epi16(255);
+    const __m512i div255 = _mm512_set1_epi16((short)0x8081);
+    __m512i inv = _mm512_sub_epi16(v255, _mm512_shufflehi_epi16(_mm512_shufflelo_epi16(top16, 0xff), 0xff));
+    return _mm512_add_epi16(top16, _mm512_srli_epi16(_mm512_mulhi_epu16(_mm512_mullo_epi16(bot16, inv), div255), 7));
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx512f,avx512bw") static inline
+__m512i PremulOver16AVX512(__m512i top, __m512i bot) {
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i lo = PremulOverHalfAVX512(_mm512_unpacklo_epi8(top, zero), _mm512_unpacklo_epi8(bot, zero));
+    __m512i hi = PremulOverHalfAVX512(_mm512_unpackhi_epi8(top, zero), _mm512_unpackhi_epi8(bot, zero));
+    return _mm512_packus_epi16(lo, hi);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx512f,avx512bw") static inline
+__m512i PremulDecay16AVX512(__m512i pix, __m512i scale) {
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i lo = _mm512_srli_epi16(_mm512_mullo_epi16(_mm512_unpacklo_epi8(pix, zero), scale), 8);
+    __m512i hi = _mm512_srli_epi16(_mm512_mullo_epi16(_mm512_unpackhi_epi8(pix, zero), scale), 8);
+    return _mm512_packus_epi16(lo, hi);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx512f,avx512bw")
+static void PremulLutOverRowAVX512(const FColor* lut, const BYTE* idx, FColor* bot, unsigned width) {
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m512i idx16 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(idx + x)));
+        __m512i top16 = _mm512_i32gather_epi32(idx16, (const void*)lut, 4);
+        __m512i bot16 = _mm512_loadu_si512((const void*)(bot + x));
+        _mm512_storeu_si512((void*)(bot + x), PremulOver16AVX512(top16, bot16));
+    }
+    PremulLutOverRowAVX2(lut, idx + x, bot + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx512f,avx512bw")
+static void PremulDecayOverRowAVX512(const FColor* lut, const BYTE* idx, FColor* top, unsigned scale, FColor* out, unsigned width) {
+    const __m512i scale32 = _mm512_set1_epi16((short)scale);
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m512i top16 = PremulDecay16AVX512(_mm512_loadu_si512((const void*)(top + x)), scale32);
+        _mm512_storeu_si512((void*)(top + x), top16);
+        __m512i idx16 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(idx + x)));
+        __m512i frame16 = _mm512_i32gather_epi32(idx16, (const void*)lut, 4);
+        _mm512_storeu_si512((void*)(out + x), PremulOver16AVX512(top16, frame16));
+    }
+    PremulDecayOverRowAVX2(lut, idx + x, top + x, scale, out + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx512f,avx512bw")
+static void StraightRowAVX512(FColor* row, unsigned width) {
+    const int* recip = (const int*)FColor::reciprocal255();
+    const __m512i mask = _mm512_set1_epi32(0xff);
+    const __m512i round = _mm512_set1_epi32(0x8000);
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m512i pix16 = _mm512_loadu_si512((const void*)(row + x));
+        __m512i recip16 = _mm512_i32gather_epi32(_mm512_srli_epi32(pix16, 24), (const void*)recip, 4);
+        __m512i blue = _mm512_and_si512(pix16, mask);
+        __m512i green = _mm512_and_si512(_mm512_srli_epi32(pix16, 8), mask);
+        __m512i red = _mm512_and_si512(_mm512_srli_epi32(pix16, 16), mask);
+        blue = _mm512_min_epu32(_mm512_srli_epi32(_mm512_add_epi32(_mm512_mullo_epi32(blue, recip16), round), 16), mask);
+        green = _mm512_min_epu32(_mm512_srli_epi32(_mm512_add_epi32(_mm512_mullo_epi32(green, recip16), round), 16), mask);
+        red = _mm512_min_epu32(_mm512_srli_epi32(_mm512_add_epi32(_mm512_mullo_epi32(red, recip16), round), 16), mask);
+        __m512i out16 = _mm512_andnot_si512(_mm512_set1_epi32(0x00ffffff), pix16);
+        out16 = _mm512_or_si512(out16, _mm512_or_si512(blue, _mm512_or_si512(_mm512_slli_epi32(green, 8), _mm512_slli_epi32(red, 16))));
+        _mm512_storeu_si512((void*)(row + x), out16);
+    }
+    StraightRowAVX2(row + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx512f,avx512bw")
+static void DecayA16RowAVX512(WORD* alpha16, FColor* row, unsigned scale, unsigned width) {
+    const __m512i scale32 = _mm512_set1_epi16((short)scale);
+    const __m512i round = _mm512_set1_epi16(128);
+    const __m512i colorMask = _mm512_set1_epi32(0x00ffffff);
+    unsigned x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m512i alpha = _mm512_loadu_si512((const void*)(alpha16 + x));
+        if (scale <= 0xffff) {
+            alpha = _mm512_mulhi_epu16(alpha, scale32);
+            _mm512_storeu_si512((void*)(alpha16 + x), alpha);
+        }
+        __m512i alpha8 = _mm512_srli_epi16(_mm512_add_epi16(alpha, round), 8);
+        __m512i lo = _mm512_slli_epi32(_mm512_cvtepu16_epi32(_mm512_castsi512_si256(alpha8)), 24);
+        __m512i hi = _mm512_slli_epi32(_mm512_cvtepu16_epi32(_mm512_extracti64x4_epi64(alpha8, 1)), 24);
+        FColor* pix = row + x;
+        _mm512_storeu_si512((void*)pix, _mm512_or_si512(_mm512_and_si512(_mm512_loadu_si512((const void*)pix), colorMask), lo));
+        _mm512_storeu_si512((void*)(pix + 16), _mm512_or_si512(_mm512_and_si512(_mm512_loadu_si512((const void*)(pix + 16)), colorMask), hi));
+    }
+    DecayA16RowAVX2(alpha16 + x, row + x, scale, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx512f,avx512bw")
+static void LutBlendOverA16RowAVX512(const FColor* lut, const BYTE* idx, FColor* bot, WORD* alpha16, unsigned width) {
+    const __m512i alphaMask = _mm512_set1_epi32((int)0xff000000);
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m512i idx16 = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(idx + x)));
+        __m512i top16 = _mm512_i32gather_epi32(idx16, (const void*)lut, 4);
+        __m512i bot16 = _mm512_loadu_si512((const void*)(bot + x));
+        __mmask16 topClear = _mm512_testn_epi32_mask(top16, alphaMask);
+        __mmask16 written = (__mmask16)(~topClear | _mm512_testn_epi32_mask(bot16, alphaMask));
+        __m512i out16 = BlendOver16AVX512(top16, bot16, topClear);
+        _mm512_storeu_si512((void*)(bot + x), out16);
+
+        __m512i alpha = _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)(alpha16 + x)));
+        alpha = _mm512_mask_blend_epi32(written, alpha, _mm512_slli_epi32(_mm512_srli_epi32(out16, 24), 8));
+        _mm256_storeu_si256((__m256i*)(alpha16 + x), _mm512_cvtepi32_epi16(alpha));
+    }
+    LutBlendOverA16RowAVX2(lut, idx + x, bot + x, alpha16 + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+LL_TARGET("avx512f,avx512bw")
+static void DecayPlaneRowAVX512(BYTE* alpha, unsigned scale, unsigned width) {
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i scale32 = _mm512_set1_epi16((short)scale);
+    unsigned x = 0;
+    for (; x + 64 <= width; x += 64) {
+        __m512i alpha64 = _mm512_loadu_si512((const void*)(alpha + x));
+        __m512i lo = _mm512_srli_epi16(_mm512_mullo_epi16(_mm512_unpacklo_epi8(alpha64, zero), scale32), 8);
+        __m512i hi = _mm512_srli_epi16(_mm512_mullo_epi16(_mm512_unpackhi_epi8(alpha64, zero), scale32), 8);
+        _mm512_storeu_si512((void*)(alpha + x), _mm512_packus_epi16(lo, hi));
+    }
+    DecayPlaneRowAVX2(alpha + x, scale, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Porter-Duff operator in 16bit lanes on straight alpha pixels. Premultiply (alpha lane kept),
+// then  (A * top + B * bot + C * top * bot) / 255  matching FColor::compositePremul.
+// Lane products may wrap, the true result is <= 65025 so the 16bit sum is exact.
+template <CompositeOp OP> LL_TARGET("avx512f,avx512bw") static inline
+__m512i CompositeHalfAVX512(__m512i top16, __m512i bot16) {
+    const __m512i v255 = _mm512_set1_epi16(255);
+    const __m512i div255 = _mm512_set1_epi16((short)0x8081);
+    const __m512i colorMask = _mm512_set1_epi64(0x0000ffffffffffffLL);
+    const __m512i alphaLane = _mm512_set1_epi64(0x00ff000000000000LL);
+    __m512i topAlpha = _mm512_shufflehi_epi16(_mm512_shufflelo_epi16(top16, 0xff), 0xff);
+    __m512i botAlpha = _mm512_shufflehi_epi16(_mm512_shufflelo_epi16(bot16, 0xff), 0xff);
+    __m512i top = _mm512_mullo_epi16(top16, _mm512_or_si512(_mm512_and_si512(topAlpha, colorMask), alphaLane));
+    __m512i bot = _mm512_mullo_epi16(bot16, _mm512_or_si512(_mm512_and_si512(botAlpha, colorMask), alphaLane));
+    top = _mm512_srli_epi16(_mm512_mulhi_epu16(top, div255), 7);
+    bot = _mm512_srli_epi16(_mm512_mulhi_epu16(bot, div255), 7);
+    if (OP == COMPOSITE_PLUS)
+        return _mm512_add_epi16(top, bot);     // packus saturates
+
+    __m512i sum;
+    if (OP == COMPOSITE_OVER || OP == COMPOSITE_SCREEN)
+        sum = _mm512_mullo_epi16(top, v255);
+    else if (OP == COMPOSITE_IN || OP == COMPOSITE_ATOP)
+        sum = _mm512_mullo_epi16(top, botAlpha);
+    else
+        sum = _mm512_mullo_epi16(top, _mm512_sub_epi16(v255, botAlpha));
+    if (OP == COMPOSITE_SCREEN)
+        sum = _mm512_add_epi16(sum, _mm512_mullo_epi16(bot, v255));
+    else if (OP != COMPOSITE_IN && OP != COMPOSITE_OUT)
+        sum = _mm512_add_epi16(sum, _mm512_mullo_epi16(bot, _mm512_sub_epi16(v255, topAlpha)));
+    if (OP == COMPOSITE_MULTIPLY)
+        sum = _mm512_add_epi16(sum, _mm512_mullo_epi16(top, bot));
+    else if (OP == COMPOSITE_SCREEN)
+        sum = _mm512_sub_epi16(sum, _mm512_mullo_epi16(top, bot));
+    return _mm512_srli_epi16(_mm512_mulhi_epu16(sum, div255), 7);
+}
+
+// -------------------------------------------------------------------------------------------------
+template <CompositeOp OP> LL_TARGET("avx512f,avx512bw")
+static void CompositePremulRowAVX512(const FColor* top, const FColor* bot, FColor* out, unsigned width) {
+    const __m512i zero = _mm512_setzero_si512();
+    unsigned x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m512i top16 = _mm512_loadu_si512((const void*)(top + x));
+        __m512i bot16 = _mm512_loadu_si512((const void*)(bot + x));
+        __m512i lo = CompositeHalfAVX512<OP>(_mm512_unpacklo_epi8(top16, zero), _mm512_unpacklo_epi8(bot16, zero));
+        __m512i hi = CompositeHalfAVX512<OP>(_mm512_unpackhi_epi8(top16, zero), _mm512_unpackhi_epi8(bot16, zero));
+        _mm512_storeu_si512((void*)(out + x), _mm512_packus_epi16(lo, hi));
+    }
+    CompositePremulRowAVX2<OP>(top + x, bot + x, out + x, width - x);
+}
+
+// -------------------------------------------------------------------------------------------------
+template <CompositeOp OP> LL_TARGET("avx512f,avx512bw")
+static void CompositeRowAVX512(const FColor* top, const FColor* bot, FColor* out, unsigned width) {
+    CompositePremulRowAVX512<OP>(top, bot, out, width);
+    StraightRowAVX512(out, width);
+}
+
+static const FKernel::CompositeRowFn CompositeRowsAVX512[COMPOSITE_OPS] = {
+    CompositeRowAVX512<COMPOSITE_OVER>, CompositeRowAVX512<COMPOSITE_IN>,
+    CompositeRowAVX512<COMPOSITE_OUT>, CompositeRowAVX512<COMPOSITE_ATOP>,
+    CompositeRowAVX512<COMPOSITE_XOR>, CompositeRowAVX512<COMPOSITE_PLUS>,
+    CompositeRowAVX512<COMPOSITE_MULTIPLY>, CompositeRowAVX512<COMPOSITE_SCREEN>
+};
+
+#endif  // HAVE_X86
+
+// =================================================================================================
+//  Cpu detection and kernel selection
+// =================================================================================================
+
+// -------------------------------------------------------------------------------------------------
+FKernel::Isa FKernel::detectIsa() {
+#if defined(HAVE_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    bool osAvx = (xcr0 & 0x06) == 0x06;
+    bool osAvx512 = (xcr0 & 0xe6) == 0xe6;
+    bool avx2 = false, avx512 = false;
+    if (maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+        avx512 = (info[1] & (1 << 16)) != 0 && (info[1] & (1 << 30)) != 0;   // F and BW
+    }
+    if (avx512 && osAvx512)
+        return ISA_AVX512;
+    if (avx && avx2 && osAvx)
+        return ISA_AVX2;
+    return sse2 ? ISA_SSE2 : ISA_SCALAR;
+#elif defined(HAVE_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        return ISA_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return ISA_AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return ISA_SSE2;
+    return ISA_SCALAR;
+#else
+    return ISA_SCALAR;
+#endif
+}
+
+// -------------------------------------------------------------------------------------------------
+FKernel::Isa FKernel::select(Isa maxIsa) {
+    Isa cpuIsa = detectIsa();
+    isa = (maxIsa < cpuIsa) ? maxIsa : cpuIsa;
+
+    blendOverRow = BlendOverRowScalar;
+    expandBlendRow = ExpandBlendRowScalar;
+    decayRow = DecayRowScalar;
+    decayExpandBlendRow = DecayExpandBlendRowScalar;
+    lutBlendOverRow = LutBlendOverRowScalar;
+    maxRow = MaxRowScalar;
+    premulLutOverRow = PremulLutOverRowScalar;
+    premulDecayOverRow = PremulDecayOverRowScalar;
+    straightRow = StraightRowScalar;
+    decayA16Row = DecayA16RowScalar;
+    lutBlendOverA16Row = LutBlendOverA16RowScalar;
+    decayPlaneRow = DecayPlaneRowScalar;
+    interleaveRow = InterleaveRowScalar;
+    deinterleaveRow = DeinterleaveRowScalar;
+    const CompositeRowFn* compositeRows = CompositeRowsScalar;
+#ifdef HAVE_X86
+    switch (isa) {
+    case ISA_AVX512:
+        blendOverRow = BlendOverRowAVX512;
+        expandBlendRow = ExpandBlendRowAVX512;
+        decayRow = DecayRowAVX512;
+        decayExpandBlendRow = DecayExpandBlendRowAVX512;
+        lutBlendOverRow = LutBlendOverRowAVX512;
+        maxRow = MaxRowAVX512;
+        premulLutOverRow = PremulLutOverRowAVX512;
+        premulDecayOverRow = PremulDecayOverRowAVX512;
+        straightRow = StraightRowAVX512;
+        decayA16Row = DecayA16RowAVX512;
+        lutBlendOverA16Row = LutBlendOverA16RowAVX512;
+        decayPlaneRow = DecayPlaneRowAVX512;
+        interleaveRow = InterleaveRowAVX2;
+        deinterleaveRow = DeinterleaveRowAVX2;
+        compositeRows = CompositeRowsAVX512;
+        break;
+    case ISA_AVX2:
+        blendOverRow = BlendOverRowAVX2;
+        expandBlendRow = ExpandBlendRowAVX2;
+        decayRow = DecayRowAVX2;
+        decayExpandBlendRow = DecayExpandBlendRowAVX2;
+        lutBlendOverRow = LutBlendOverRowAVX2;
+        maxRow = MaxRowAVX2;
+        premulLutOverRow = PremulLutOverRowAVX2;
+        premulDecayOverRow = PremulDecayOverRowAVX2;
+        straightRow = StraightRowAVX2;
+        decayA16Row = DecayA16RowAVX2;
+        lutBlendOverA16Row = LutBlendOverA16RowAVX2;
+        decayPlaneRow = DecayPlaneRowAVX2;
+        interleaveRow = InterleaveRowAVX2;
+        deinterleaveRow = DeinterleaveRowAVX2;
+        compositeRows = CompositeRowsAVX2;
+        break;
+    case ISA_SSE2:
+        blendOverRow = BlendOverRowSSE2;
+        expandBlendRow = ExpandBlendRowSSE2;
+        decayRow = DecayRowSSE2;
+        decayExpandBlendRow = DecayExpandBlendRowSSE2;
+        lutBlendOverRow = LutBlendOverRowSSE2;
+        maxRow = MaxRowSSE2;
+        premulLutOverRow = PremulLutOverRowSSE2;
+        premulDecayOverRow = PremulDecayOverRowSSE2;
+        decayA16Row = DecayA16RowSSE2;
+        lutBlendOverA16Row = LutBlendOverA16RowSSE2;
+        decayPlaneRow = DecayPlaneRowSSE2;
+        interleaveRow = InterleaveRowSSE2;
+        deinterleaveRow = DeinterleaveRowSSE2;
+        compositeRows = CompositeRowsSSE2;
+        break;
+    case ISA_SCALAR:
+        break;
+    }
+#endif
+    for (unsigned op = 0; op < COMPOSITE_OPS; op++) {
+        compositeRow[op] = compositeRows[op];
+    }
+
+    // Linear light kernels need gathers, SSE2 uses scalar and AVX-512 uses AVX2.
+    if (linear) {
+        blendOverRow = BlendOverLinearRowScalar;
+        expandBlendRow = ExpandBlendLinearRowScalar;
+        decayExpandBlendRow = DecayExpandBlendLinearRowScalar;
+        lutBlendOverRow = LutBlendOverLinearRowScalar;
+#ifdef HAVE_X86
+        if (isa >= ISA_AVX2) {
+            blendOverRow = BlendOverLinearRowAVX2;
+            expandBlendRow = ExpandBlendLinearRowAVX2;
+            decayExpandBlendRow = DecayExpandBlendLinearRowAVX2;
+            lutBlendOverRow = LutBlendOverLinearRowAVX2;
+        }
+#endif
+    }
+    return isa;
+}
+
+// -------------------------------------------------------------------------------------------------
+FKernel::Isa FKernel::selectLinear(bool linearLight) {
+    linear = linearLight;
+    return select(isa);
+}
+
+// -------------------------------------------------------------------------------------------------
+const char* FKernel::toString(Isa isa) {
+    switch (isa) {
+    case ISA_SSE2:
+        return "sse2";
+    case ISA_AVX2:
+        return "avx2";
+    case ISA_AVX512:
+        return "avx512";
+    case ISA_SCALAR:
+        break;
+    }
+    return "scalar";
+}
+
+// -------------------------------------------------------------------------------------------------
+bool FKernel::parseIsa(const char* name, Isa& outIsa) {
+    for (int idx = ISA_SCALAR; idx <= ISA_AVX512; idx++) {
+        if (strcmp(name, toString((Isa)idx)) == 0) {
+            outIsa = (Isa)idx;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Select the best kernels at startup.
+static const FKernel::Isa startupIsa = FKernel::select(FKernel::ISA_AVX512);
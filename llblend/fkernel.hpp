@@ -0,0 +1,126 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FKernel.hpp
+//  Desc: Scanline pixel kernels (SIMD) with runtime cpu dispatch.
+//
+//  FKernel created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include "fcolor.hpp"
+
+// Row (scanline) kernels. Each kernel has a scalar version plus SSE2, AVX2 and AVX-512
+// versions on x86, a kernel missing a version uses the next lower one.
+// The fastest version the cpu supports is selected at startup.
+// All versions produce bit-identical output to the scalar FColor methods.
+class FKernel {
+public:
+    enum Isa { ISA_SCALAR, ISA_SSE2, ISA_AVX2, ISA_AVX512 };
+
+    // bot[x] = top[x] blendOver bot[x]
+    typedef void (*BlendOverRowFn)(const FColor* top, FColor* bot, unsigned width);
+
+    // out[x] = lut[idx[x]], then top[x] blendOver out[x] when top is not null.
+    // Fuses 8bit palette expansion (ConvertTo32Bits) with the overlay blend.
+    typedef void (*ExpandBlendRowFn)(const FColor* lut, const BYTE* idx, const FColor* top, FColor* out, unsigned width);
+
+    // row[x].alpha = row[x].alpha * scale / 256   (same as FImage::AdjustAlphaP32, scale <= 256)
+    typedef void (*DecayRowFn)(FColor* row, unsigned scale, unsigned width);
+
+    // Decay top alpha (written back), then out[x] = top[x] blendOver lut[idx[x]].
+    // Single pass over the overlay, replaces AdjustAlphaP32 + expandBlendRow.
+    typedef void (*DecayExpandBlendRowFn)(const FColor* lut, const BYTE* idx, FColor* top, unsigned scale, FColor* out, unsigned width);
+
+    // bot[x] = lut[idx[x]] blendOver bot[x]   (8bit palette image blended over 32bit)
+    typedef void (*LutBlendOverRowFn)(const FColor* lut, const BYTE* idx, FColor* bot, unsigned width);
+
+    // out[x] = max(in[x], out[x])   (8bit index maximum, pmaxub)
+    typedef void (*MaxRowFn)(const BYTE* in, BYTE* out, unsigned width);
+
+    // bot[x] = lut[idx[x]] premulOver bot[x]   (premultiplied lut and bottom)
+    typedef void (*PremulLutOverRowFn)(const FColor* lut, const BYTE* idx, FColor* bot, unsigned width);
+
+    // Decay all four channels of premultiplied top (written back), then out[x] = top[x] premulOver lut[idx[x]].
+    typedef void (*PremulDecayOverRowFn)(const FColor* lut, const BYTE* idx, FColor* top, unsigned scale, FColor* out, unsigned width);
+
+    // row[x] = row[x].straight()   (premultiplied to straight alpha, reciprocal table)
+    typedef void (*StraightRowFn)(FColor* row, unsigned width);
+
+    // alpha16[x] = alpha16[x] * scale / 65536  (8.8 fixed point alpha, scale <= 65536),
+    // then row[x].alpha = alpha16[x] rounded to 8bit.
+    typedef void (*DecayA16RowFn)(WORD* alpha16, FColor* row, unsigned scale, unsigned width);
+
+    // lutBlendOverRow on bot whose alpha is alpha16 rounded to 8bit. Pixels blendOver writes
+    // (top alpha not 0 or bot alpha 0) set alpha16[x] = bot[x].alpha << 8.
+    typedef void (*LutBlendOverA16RowFn)(const FColor* lut, const BYTE* idx, FColor* bot, WORD* alpha16, unsigned width);
+
+    // alpha[x] = alpha[x] * scale / 256   (planar alpha, scale <= 256)
+    typedef void (*DecayPlaneRowFn)(BYTE* alpha, unsigned scale, unsigned width);
+
+    // out[x] = FColor(red[x], green[x], blue[x], alpha[x])   (planar to BGRA)
+    typedef void (*InterleaveRowFn)(const BYTE* blue, const BYTE* green, const BYTE* red, const BYTE* alpha, FColor* out, unsigned width);
+
+    // blue[x], green[x], red[x], alpha[x] = in[x]   (BGRA to planar)
+    typedef void (*DeinterleaveRowFn)(const FColor* in, BYTE* blue, BYTE* green, BYTE* red, BYTE* alpha, unsigned width);
+
+    // out[x] = top[x] OP bot[x]   (FColor::composite, straight alpha). out may alias top or bot.
+    typedef void (*CompositeRowFn)(const FColor* top, const FColor* bot, FColor* out, unsigned width);
+
+    static BlendOverRowFn blendOverRow;
+    static ExpandBlendRowFn expandBlendRow;
+    static DecayRowFn decayRow;
+    static DecayExpandBlendRowFn decayExpandBlendRow;
+    static LutBlendOverRowFn lutBlendOverRow;
+    static MaxRowFn maxRow;
+    static PremulLutOverRowFn premulLutOverRow;
+    static PremulDecayOverRowFn premulDecayOverRow;
+    static StraightRowFn straightRow;
+    static DecayA16RowFn decayA16Row;
+    static LutBlendOverA16RowFn lutBlendOverA16Row;
+    static DecayPlaneRowFn decayPlaneRow;
+    static InterleaveRowFn interleaveRow;
+    static DeinterleaveRowFn deinterleaveRow;
+    static CompositeRowFn compositeRow[COMPOSITE_OPS];     // Indexed by CompositeOp
+
+    static Isa detectIsa();
+    static Isa getIsa() { return isa; }
+    static Isa select(Isa maxIsa);      // Select kernels up to maxIsa, limited by cpu.
+    // Blend over kernels (blendOverRow, expandBlendRow, decayExpandBlendRow, lutBlendOverRow)
+    // mix in linear light (FColor::blendOverLinear) instead of on sRGB bytes.
+    static Isa selectLinear(bool linearLight);
+    static bool isLinear() { return linear; }
+    static bool parseIsa(const char* name, Isa& outIsa);
+    static const char* toString(Isa isa);
+
+private:
+    static Isa isa;
+    static bool linear;
+};
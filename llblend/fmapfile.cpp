@@ -0,0 +1,175 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FMapFile.cpp
+//  Desc: Read only memory mapped file with a budget of open files.
+//
+//  FMapFile created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+
+#include "fmapfile.hpp"
+
+#include <stdio.h>
+
+#ifdef HAVE_WIN
+    #define byte win_byte_override  // Fix for c++ v17
+    #include <windows.h>
+    #undef byte                     // Fix for c++ v17
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+std::mutex FMapFile::budgetMutex;
+std::condition_variable FMapFile::budgetCv;
+unsigned FMapFile::budget = FMapFile::DEFAULT_BUDGET;
+unsigned FMapFile::openCnt = 0;
+
+// -------------------------------------------------------------------------------------------------
+void FMapFile::setBudget(unsigned openFiles) {
+    std::lock_guard<std::mutex> lock(budgetMutex);
+    budget = (openFiles != 0) ? openFiles : DEFAULT_BUDGET;
+    budgetCv.notify_all();
+}
+
+// -------------------------------------------------------------------------------------------------
+unsigned FMapFile::getBudget() {
+    std::lock_guard<std::mutex> lock(budgetMutex);
+    return budget;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Open file counts against the budget only while its handle is open.
+FMapFile::FMapFile(const char* path, bool _copyOnWrite)
+    : data(nullptr), size(0), mapping(nullptr), copyOnWrite(_copyOnWrite) {
+    {
+        std::unique_lock<std::mutex> lock(budgetMutex);
+        budgetCv.wait(lock, [] { return openCnt < budget; });
+        openCnt++;
+    }
+
+    if (! map(path)) {
+        read(path);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(budgetMutex);
+        openCnt--;
+    }
+    budgetCv.notify_one();
+}
+
+// -------------------------------------------------------------------------------------------------
+FMapFile::~FMapFile() {
+    if (mapping != nullptr) {
+#ifdef HAVE_WIN
+        UnmapViewOfFile(mapping);
+#else
+        munmap(mapping, size);
+#endif
+    }
+}
+
+#ifdef HAVE_WIN
+// -------------------------------------------------------------------------------------------------
+bool FMapFile::map(const char* path) {
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    HANDLE view = nullptr;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        view = CreateFileMappingA(file, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+    }
+    CloseHandle(file);
+    if (view == nullptr)
+        return false;
+
+    mapping = MapViewOfFile(view, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(view);      // View keeps the mapping
+    if (mapping == nullptr)
+        return false;
+
+    data = (const unsigned char*)mapping;
+    size = (size_t)fileSize.QuadPart;
+    return true;
+}
+#else
+// -------------------------------------------------------------------------------------------------
+bool FMapFile::map(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info;
+    void* view = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        int prot = copyOnWrite ? (PROT_READ | PROT_WRITE) : PROT_READ;
+        view = mmap(nullptr, (size_t)info.st_size, prot, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);              // Mapping keeps the file
+    if (view == MAP_FAILED)
+        return false;
+
+#ifdef MADV_SEQUENTIAL
+    madvise(view, (size_t)info.st_size, MADV_SEQUENTIAL);
+#endif
+    mapping = view;
+    data = (const unsigned char*)view;
+    size = (size_t)info.st_size;
+    return true;
+}
+#endif
+
+// -------------------------------------------------------------------------------------------------
+// Fall back when the file can not be mapped, read in one pass.
+bool FMapFile::read(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (file == nullptr)
+        return false;
+
+    unsigned char chunk[64 * 1024];
+    size_t got;
+    while ((got = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        buffer.insert(buffer.end(), chunk, chunk + got);
+    }
+    fclose(file);
+
+    if (buffer.empty())
+        return false;
+    data = buffer.data();
+    size = buffer.size();
+    return true;
+}
@@ -0,0 +1,87 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FMapFile.hpp
+//  Desc: Read only memory mapped file with a budget of open files.
+//
+//  FMapFile created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#pragma once
+
+#include "ll_stdhdr.hpp"
+
+#include <condition_variable>
+#include <mutex>
+#include <stddef.h>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Whole file mapped read only, unmapped when destroyed. Files which can not be mapped
+// (ex: empty, pipes, some network mounts) are read into memory instead.
+// A copy on write mapping can be written, pages written are private copies (file is unchanged).
+// Open files are limited to a shared budget, open waits while the budget is used up,
+// the file handle is released as soon as the file is mapped or read.
+class FMapFile {
+public:
+    explicit FMapFile(const char* path, bool copyOnWrite = false);
+    ~FMapFile();
+
+    FMapFile(const FMapFile&) = delete;
+    FMapFile& operator=(const FMapFile&) = delete;
+
+    bool Valid() const
+    { return data != nullptr; }
+    const unsigned char* Data() const
+    { return data; }
+    unsigned char* WritableData() const     // Copy on write only
+    { return copyOnWrite ? (unsigned char*)data : nullptr; }
+    size_t Size() const
+    { return size; }
+
+    static void setBudget(unsigned openFiles);  // 0 = default budget
+    static unsigned getBudget();
+
+private:
+    const unsigned char* data;
+    size_t size;
+    void* mapping;                      // Mapped view, null if read into buffer
+    const bool copyOnWrite;
+    std::vector<unsigned char> buffer;
+
+    bool map(const char* path);
+    bool read(const char* path);
+
+    static std::mutex budgetMutex;
+    static std::condition_variable budgetCv;
+    static unsigned budget;
+    static unsigned openCnt;
+    static const unsigned DEFAULT_BUDGET = 64;
+};
@@ -0,0 +1,952 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FOverlay.cpp
+//  Desc: Time lapse overlay which accumulates decaying frames.
+//
+//  FOverlay created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "foverlay.hpp"
+#include "blendfutil.hpp"
+#include "fkernel.hpp"
+#include "fthreadpool.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdint.h>
+#include <string.h>
+
+// -------------------------------------------------------------------------------------------------
+FOverlay* FOverlay::Create(OverlayMode mode, unsigned width, unsigned height, float decay) {
+    switch (mode) {
+    case OVERLAY_P32:
+        return new FOverlayP32(width, height, decay);
+    case OVERLAY_LAZY:
+        return new FOverlayLazy(width, height, decay);
+    case OVERLAY_TILED:
+        return new FOverlayTiled(width, height, decay);
+    case OVERLAY_PREMUL:
+        return new FOverlayPremul(width, height, decay);
+    case OVERLAY_A16:
+        return new FOverlayA16(width, height, decay);
+    case OVERLAY_PLANAR:
+        return new FOverlayPlanar(width, height, decay);
+    case OVERLAY_INDEX:
+        return new FOverlayIndex(width, height, decay);
+    case OVERLAY_NONE:
+        break;
+    }
+    return nullptr;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool FOverlay::Same(const FOverlay* overlay, const FOverlay* other) {
+    FImageRef imgRef(overlay != nullptr ? overlay->ToImage() : nullptr);
+    FImageRef otherRef(other != nullptr ? other->ToImage() : nullptr);
+    if (! BlendFUtil::SameOverlay(imgRef.get(), otherRef.get()))
+        return false;
+    return overlay == nullptr || other == nullptr || overlay->SameHidden(*other);
+}
+
+// -------------------------------------------------------------------------------------------------
+void FOverlay::UpdateFrames(const std::vector<const FImage*>& framesI8, const std::vector<FColor>& overlayLuts) {
+    FImageRef outImgRef;
+    for (size_t idx = 0; idx < framesI8.size(); idx++) {
+        const FImage& frameI8 = *framesI8[idx];
+        if (outImgRef == nullptr || outImgRef->GetWidth() != frameI8.GetWidth() || outImgRef->GetHeight() != frameI8.GetHeight()) {
+            FImageRef imgRef(FImage::Allocate(frameI8.GetWidth(), frameI8.GetHeight(), 32));
+            outImgRef.swap(imgRef);
+        }
+        Composite(&overlayLuts[idx * 256], frameI8, *outImgRef);
+        Update(&overlayLuts[idx * 256], frameI8);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// Decay table repeats the per frame integer decay of AdjustAlphaP32,
+//   table[age * 256 + alpha] = table[(age-1) * 256 + alpha] * scale / 256
+// until every alpha reaches 0 at the returned max age, which is at most 255.
+// No decay (scale 256) keeps only the age 0 row and returns 0.
+unsigned FOverlay::DecayTable(float decay, std::vector<BYTE>& table) {
+    unsigned scale = (unsigned)(256 * decay);
+    unsigned maxAge = 0;
+    table.resize(256);
+    for (unsigned alpha = 0; alpha < 256; alpha++) {
+        table[alpha] = (BYTE)alpha;
+    }
+    if (scale < 256) {
+        bool live = true;
+        while (live) {
+            size_t prev = (size_t)maxAge * 256;
+            table.resize(prev + 512);
+            live = false;
+            for (unsigned alpha = 0; alpha < 256; alpha++) {
+                BYTE next = table[prev + alpha] * scale / 256;
+                table[prev + 256 + alpha] = next;
+                live |= (next != 0);
+            }
+            maxAge++;
+        }
+    }
+    return maxAge;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Same integer decay as AdjustAlphaP32, applied until full alpha reaches 0.
+unsigned FOverlay::DecayFrames(float decay) {
+    unsigned scale = (unsigned)(256 * decay);
+    if (scale >= 256)
+        return NEVER;
+
+    unsigned frames = 0;
+    for (unsigned alpha = 255; alpha != 0; alpha = alpha * scale / 256) {
+        frames++;
+    }
+    return frames;
+}
+
+// =================================================================================================
+//  FOverlayP32
+// =================================================================================================
+
+// -------------------------------------------------------------------------------------------------
+FOverlayP32::FOverlayP32(unsigned width, unsigned height, float decay)
+    : FOverlay(width, height, decay), imgRef(FImage::Allocate(width, height, 32)) {
+    imgRef->FillImage(FPalette::TRANSPARENT);
+}
+
+// -------------------------------------------------------------------------------------------------
+void FOverlayP32::Composite(const FColor* frameLut, const FImage& frameI8, FImage& outP32) {
+    BlendFUtil::DecayExpandBlendI8_P32(frameLut, frameI8, imgRef, decay, outP32);
+}
+
+// -------------------------------------------------------------------------------------------------
+void FOverlayP32::Update(const FColor* overlayLut, const FImage& frameI8) {
+    BlendFUtil::BlendLutI8_P32(overlayLut, frameI8, imgRef);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Same as Composite and Update per frame. Each row runs through every frame while in cache,
+// the decays since a row was last written are applied at once from decayPow[decays][alpha].
+void FOverlayP32::UpdateFrames(const std::vector<const FImage*>& framesI8, const std::vector<FColor>& overlayLuts) {
+    unsigned count = (unsigned)framesI8.size();
+    for (const FImage* frameI8 : framesI8) {
+        if (frameI8->GetWidth() != width || frameI8->GetHeight() != height) {
+            FOverlay::UpdateFrames(framesI8, overlayLuts);
+            return;
+        }
+    }
+
+    // Frames with index 0 transparent only write their spans, others write every pixel.
+    std::vector<const FSpans*> spans(count, nullptr);
+    for (unsigned idx = 0; idx < count; idx++) {
+        if (BlendFUtil::useSpans && overlayLuts[idx * 256].rgbReserved == 0) {
+            spans[idx] = &framesI8[idx]->Spans();
+        }
+    }
+
+    unsigned scale = (unsigned)(256 * decay);
+    std::vector<BYTE> decayPow((size_t)(count + 1) * 256);
+    for (unsigned alpha = 0; alpha < 256; alpha++) {
+        decayPow[alpha] = (BYTE)alpha;
+    }
+    for (size_t pos = 256; pos < decayPow.size(); pos++) {
+        decayPow[pos] = (BYTE)(decayPow[pos - 256] * std::min(scale, 256u) / 256);
+    }
+
+    auto decayBy = [&](FColor* row, unsigned decays) {
+        if (decays == 1) {
+            FKernel::decayRow(row, scale, width);
+        } else if (decays > 1) {
+            const BYTE* pow = &decayPow[(size_t)decays * 256];
+            for (unsigned x = 0; x < width; x++) {
+                row[x].rgbReserved = pow[row[x].rgbReserved];
+            }
+        }
+    };
+
+    FThreadPool::get().forBands(height, width * 4, [&](unsigned y0, unsigned y1) {
+        for (unsigned y = y0; y < y1; y++) {
+            FColor* row = (FColor*)imgRef->ScanLine(y);
+            unsigned decays = 0;    // Decays not yet applied to row
+            for (unsigned idx = 0; idx < count; idx++) {
+                decays++;
+                const FSpans* frameSpans = spans[idx];
+                if (frameSpans != nullptr && frameSpans->begin(y) == frameSpans->end(y))
+                    continue;
+
+                decayBy(row, decays);
+                decays = 0;
+                const BYTE* top = framesI8[idx]->ReadScanLine(y);
+                const FColor* lut = &overlayLuts[idx * 256];
+                if (frameSpans != nullptr) {
+                    for (const FSpan* span = frameSpans->begin(y); span != frameSpans->end(y); span++) {
+                        FKernel::lutBlendOverRow(lut, top + span->x, row + span->x, span->len);
+                    }
+                } else {
+                    FKernel::lutBlendOverRow(lut, top, row, width);
+                }
+            }
+            decayBy(row, decays);
+        }
+    });
+}
+
+// -------------------------------------------------------------------------------------------------
+FImage* FOverlayP32::ToImage() const {
+    return imgRef->Clone();
+}
+
+// -------------------------------------------------------------------------------------------------
+FOverlay* FOverlayP32::Clone() const {
+    FOverlayP32* copy = new FOverlayP32(width, height, decay);
+    copy->imgRef.reset(imgRef->Clone());
+    return copy;
+}
+
+// =================================================================================================
+//  FOverlayLazy
+// =================================================================================================
+
+// -------------------------------------------------------------------------------------------------
+FOverlayLazy::FOverlayLazy(unsigned width, unsigned height, float decay)
+    : FOverlay(width, height, decay),
+      baseRef(FImage::Allocate(width, height, 32)),
+      stamps((size_t)width * height, 0),
+      rowStamps(height, NEVER),
+      maxAge(DecayTable(decay, decayTable)),
+      frame(0) {
+    baseRef->FillImage(FPalette::TRANSPARENT);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Overlay row with alpha decayed to the current frame.
+void FOverlayLazy::effectiveRow(unsigned y, FColor* row) const {
+    const FColor* base = (const FColor*)baseRef->ReadScanLine(y);
+    const unsigned* stamp = &stamps[(size_t)y * width];
+    for (unsigned x = 0; x < width; x++) {
+        BYTE alpha = decayAlpha(frame - stamp[x], base[x].rgbReserved);
+        row[x] = (alpha != 0) ? FColor(base[x], alpha) : FPalette::TRANSPARENT;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+void FOverlayLazy::Composite(const FColor* frameLut, const FImage& frameI8, FImage& outP32) {
+    frame++;    // Ages every pixel by one frame.
+
+    unsigned height = std::min(frameI8.GetHeight(), outP32.GetHeight());
+    unsigned width = std::min(frameI8.GetWidth(), outP32.GetWidth());
+    unsigned widthBlend = std::min(width, this->width);
+    const FSpans* frameSpans = BlendFUtil::useSpans ? &frameI8.Spans() : nullptr;
+
+    FThreadPool::get().forBands(height, width * 4, [&](unsigned y0, unsigned y1) {
+        std::vector<FColor> rowBuf(this->width);
+        for (unsigned y = y0; y < y1; y++) {
+            const BYTE* bot = frameI8.ReadScanLine(y);
+            FColor* out = (FColor*)outP32.ScanLine(y);
+            if (y < this->height && rowLive(y)) {
+                effectiveRow(y, rowBuf.data());
+                FKernel::expandBlendRow(frameLut, bot, rowBuf.data(), out, widthBlend);
+                BlendFUtil::ExpandI8Row(frameLut, frameI8, frameSpans, y, out, widthBlend, width);
+            } else {
+                BlendFUtil::ExpandI8Row(frameLut, frameI8, frameSpans, y, out, 0, width);
+            }
+        }
+    });
+}
+
+// -------------------------------------------------------------------------------------------------
+// Only pixels with a visible overlay color are written.
+// Frame spans skip index 0 runs when index 0 maps to transparent.
+void FOverlayLazy::Update(const FColor* overlayLut, const FImage& frameI8) {
+    unsigned height = std::min(frameI8.GetHeight(), this->height);
+    unsigned width = std::min(frameI8.GetWidth(), this->width);
+    const FSpans* spans = (BlendFUtil::useSpans && overlayLut[0].rgbReserved == 0) ? &frameI8.Spans() : nullptr;
+    const FSpan allSpan = { 0, width };
+
+    FThreadPool::get().forBands(height, width * 4, [&](unsigned y0, unsigned y1) {
+        for (unsigned y = y0; y < y1; y++) {
+            const BYTE* top = frameI8.ReadScanLine(y);
+            FColor* base = (FColor*)baseRef->ScanLine(y);
+            unsigned* stamp = &stamps[(size_t)y * this->width];
+            bool wrote = false;
+
+            const FSpan* span = (spans != nullptr) ? spans->begin(y) : &allSpan;
+            const FSpan* spanEnd = (spans != nullptr) ? spans->end(y) : &allSpan + 1;
+            for (; span != spanEnd && span->x < width; span++) {
+                unsigned x1 = std::min(span->x + span->len, width);
+                for (unsigned x = span->x; x < x1; x++) {
+                    const FColor& topColor = overlayLut[top[x]];
+                    if (topColor.rgbReserved != 0) {
+                        BYTE alpha = decayAlpha(frame - stamp[x], base[x].rgbReserved);
+                        FColor botColor = (alpha != 0) ? FColor(base[x], alpha) : FPalette::TRANSPARENT;
+                        topColor.blendOver(botColor);
+                        base[x] = botColor;
+                        stamp[x] = frame;
+                        wrote = true;
+                    }
+                }
+            }
+            if (wrote) {
+                rowStamps[y] = frame;
+            }
+        }
+    });
+}
+
+// -------------------------------------------------------------------------------------------------
+FImage* FOverlayLazy::ToImage() const {
+    FImage* imgPtr = FImage::Allocate(width, height, 32);
+    for (unsigned y = 0; y < height; y++) {
+        FColor* row = (FColor*)imgPtr->ScanLine(y);
+        if (rowLive(y)) {
+            effectiveRow(y, row);
+        } else {
+            std::fill(row, row + width, FPalette::TRANSPARENT);
+        }
+    }
+    return imgPtr;
+}
+
+// -------------------------------------------------------------------------------------------------
+FOverlay* FOverlayLazy::Clone() const {
+    FOverlayLazy* copy = new FOverlayLazy(width, height, decay);
+    copy->baseRef.reset(baseRef->Clone());
+    copy->stamps = stamps;
+    copy->rowStamps = rowStamps;
+    copy->frame = frame;
+    return copy;
+}
+
+// =================================================================================================
+//  FOverlayTiled
+// =================================================================================================
+
+// -------------------------------------------------------------------------------------------------
+// True if any pixel has alpha.
+static bool AnyAlpha(const FColor* row, unsigned width) {
+    const uint32_t* pixels = (const uint32_t*)row;
+    uint32_t bits = 0;
+    for (unsigned x = 0; x < width; x++) {
+        bits |= pixels[x];
+    }
+    return (bits & 0xff000000) != 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+FOverlayTiled::FOverlayTiled(unsigned width, unsigned height, float decay)
+    : FOverlay(width, height, decay),
+      imgRef(FImage::Allocate(width, height, 32)),
+      tilesX((width + TILE - 1) / TILE),
+      tilesY((height + TILE - 1) / TILE),
+      overlayLive(tilesX * tilesY, 0),
+      frameLive(tilesX * tilesY, 0),
+      outClear(tilesX * tilesY, 0),
+      lastOut(nullptr),
+      outColor(FPalette::TRANSPARENT) {
+    imgRef->FillImage(FPalette::TRANSPARENT);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Mark frame tiles with any pixel not index 0, from the frame spans.
+void FOverlayTiled::frameTiles(const FImage& frameI8) {
+    std::fill(frameLive.begin(), frameLive.end(), 0);
+    const FSpans& spans = frameI8.Spans();
+    for (unsigned y = 0; y < height; y++) {
+        BYTE* live = &frameLive[(y / TILE) * tilesX];
+        for (const FSpan* span = spans.begin(y); span != spans.end(y); span++) {
+            for (unsigned tx = span->x / TILE; tx <= (span->x + span->len - 1) / TILE; tx++) {
+                live[tx] = 1;
+            }
+        }
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+void FOverlayTiled::Composite(const FColor* frameLut, const FImage& frameI8, FImage& outP32) {
+    if (! sameSize(frameI8) || ! sameSize(outP32)) {
+        BlendFUtil::DecayExpandBlendI8_P32(frameLut, frameI8, imgRef, decay, outP32);
+        std::fill(overlayLive.begin(), overlayLive.end(), 1);
+        lastOut = nullptr;
+        return;
+    }
+
+    // Cleared output tiles are only valid for the same output image and index 0 color.
+    if (&outP32 != lastOut || memcmp(&frameLut[0], &outColor, sizeof(outColor)) != 0) {
+        std::fill(outClear.begin(), outClear.end(), 0);
+        lastOut = &outP32;
+        outColor = frameLut[0];
+    }
+
+    frameTiles(frameI8);
+    const FSpans* frameSpans = BlendFUtil::useSpans ? &frameI8.Spans() : nullptr;
+
+    // Tile rows run in parallel, each only touches its own tile state and output rows.
+    unsigned scale = (unsigned)(256 * decay);
+    FThreadPool::get().forEach(tilesY, [&](unsigned ty) {
+        unsigned y0 = ty * TILE;
+        unsigned y1 = std::min(y0 + TILE, height);
+        for (unsigned tx = 0; tx < tilesX; tx++) {
+            unsigned tile = ty * tilesX + tx;
+            unsigned x0 = tx * TILE;
+            unsigned w = std::min(TILE, width - x0);
+
+            if (overlayLive[tile]) {
+                bool live = false;
+                for (unsigned y = y0; y < y1; y++) {
+                    const BYTE* idx = frameI8.ReadScanLine(y) + x0;
+                    FColor* top = (FColor*)imgRef->ScanLine(y) + x0;
+                    FColor* out = (FColor*)outP32.ScanLine(y) + x0;
+                    FKernel::decayExpandBlendRow(frameLut, idx, top, scale, out, w);
+                    live = live || AnyAlpha(top, w);
+                }
+                overlayLive[tile] = live;
+                outClear[tile] = 0;
+            } else if (frameLive[tile] || ! outClear[tile]) {
+                for (unsigned y = y0; y < y1; y++) {
+                    FColor* out = (FColor*)outP32.ScanLine(y);
+                    BlendFUtil::ExpandI8Row(frameLut, frameI8, frameSpans, y, out, x0, x0 + w);
+                }
+                outClear[tile] = ! frameLive[tile];
+            }
+        }
+    });
+}
+
+// -------------------------------------------------------------------------------------------------
+// Only frame tiles not index 0 are blended into the overlay, requires index 0 to map transparent.
+void FOverlayTiled::Update(const FColor* overlayLut, const FImage& frameI8) {
+    if (! sameSize(frameI8) || overlayLut[0].rgbReserved != 0) {
+        BlendFUtil::BlendLutI8_P32(overlayLut, frameI8, imgRef);
+        std::fill(overlayLive.begin(), overlayLive.end(), 1);
+        return;
+    }
+
+    frameTiles(frameI8);
+
+    FThreadPool::get().forEach(tilesY, [&](unsigned ty) {
+        unsigned y0 = ty * TILE;
+        unsigned y1 = std::min(y0 + TILE, height);
+        for (unsigned tx = 0; tx < tilesX; tx++) {
+            unsigned tile = ty * tilesX + tx;
+            if (frameLive[tile]) {
+                unsigned x0 = tx * TILE;
+                unsigned w = std::min(TILE, width - x0);
+                for (unsigned y = y0; y < y1; y++) {
+                    const BYTE* idx = frameI8.ReadScanLine(y) + x0;
+                    FColor* top = (FColor*)imgRef->ScanLine(y) + x0;
+                    FKernel::lutBlendOverRow(overlayLut, idx, top, w);
+                }
+                overlayLive[tile] = 1;
+            }
+        }
+    });
+}
+
+// -------------------------------------------------------------------------------------------------
+FImage* FOverlayTiled::ToImage() const {
+    return imgRef->Clone();
+}
+
+// -------------------------------------------------------------------------------------------------
+// Output tile state is not copied, the copy clears it on its first Composite.
+FOverlay* FOverlayTiled::Clone() const {
+    FOverlayTiled* copy = new FOverlayTiled(width, height, decay);
+    copy->imgRef.reset(imgRef->Clone());
+    copy->overlayLive = overlayLive;
+    return copy;
+}
+
+// =================================================================================================
+//  FOverlayPremul
+// =================================================================================================
+
+// -------------------------------------------------------------------------------------------------
+FOverlayPremul::FOverlayPremul(unsigned width, unsigned height, float decay)
+    : FOverlay(width, height, decay), imgRef(FImage::Allocate(width, height, 32)) {
+    imgRef->FillImage(FColor(0, 0, 0, 0));
+}
+
+// -------------------------------------------------------------------------------------------------
+void FOverlayPremul::Premultiply(const FColor* lut, FColor* lutPre) {
+    for (unsigned idx = 0; idx < 256; idx++) {
+        lutPre[idx] = lut[idx].premultiplied();
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// Decay overlay and blend it over the frame, output converted to straight alpha.
+// Frame pixels outside the overlay are expanded, overlay pixels outside the frame only decay.
+void FOverlayPremul::Composite(const FColor* frameLut, const FImage& frameI8, FImage& outP32) {
+    FColor frameLutPre[256];
+    Premultiply(frameLut, frameLutPre);
+
+    unsigned scale = (unsigned)(256 * decay);
+    unsigned frameHeight = std::min(frameI8.GetHeight(), outP32.GetHeight());
+    unsigned frameWidth = std::min(frameI8.GetWidth(), outP32.GetWidth());
+    unsigned blendWidth = std::min(frameWidth, width);
+    const FSpans* frameSpans = BlendFUtil::useSpans ? &frameI8.Spans() : nullptr;
+
+    FThreadPool::get().forBands(std::max(frameHeight, height), std::max(frameWidth, width) * 4, [&](unsigned y0, unsigned y1) {
+        for (unsigned y = y0; y < y1; y++) {
+            FColor* top = (y < height) ? (FColor*)imgRef->ScanLine(y) : nullptr;
+            unsigned x0 = 0;
+            if (y < frameHeight) {
+                FColor* out = (FColor*)outP32.ScanLine(y);
+                if (top != nullptr) {
+                    FKernel::premulDecayOverRow(frameLutPre, frameI8.ReadScanLine(y), top, scale, out, blendWidth);
+                    FKernel::straightRow(out, blendWidth);
+                    x0 = blendWidth;
+                }
+                BlendFUtil::ExpandI8Row(frameLut, frameI8, frameSpans, y, out, x0, frameWidth);
+            }
+            for (unsigned x = x0; top != nullptr && x < width; x++) {
+                top[x].premulDecay(scale);
+            }
+        }
+    });
+}
+
+// -------------------------------------------------------------------------------------------------
+void FOverlayPremul::Update(const FColor* overlayLut, const FImage& frameI8) {
+    FColor overlayLutPre[256];
+    Premultiply(overlayLut, overlayLutPre);
+
+    unsigned updateHeight = std::min(frameI8.GetHeight(), height);
+    unsigned updateWidth = std::min(frameI8.GetWidth(), width);
+
+    // Transparent index 0 runs leave the overlay unchanged.
+    const FSpans* spans = (BlendFUtil::useSpans && overlayLutPre[0].rgbReserved == 0) ? &frameI8.Spans() : nullptr;
+
+    FThreadPool::get().forBands(updateHeight, updateWidth * 4, [&](unsigned y0, unsigned y1) {
+        for (unsigned y = y0; y < y1; y++) {
+            const BYTE* idx = frameI8.ReadScanLine(y);
+            FColor* bot = (FColor*)imgRef->ScanLine(y);
+            if (spans != nullptr) {
+                for (const FSpan* span = spans->begin(y); span != spans->end(y) && span->x < updateWidth; span++) {
+                    FKernel::premulLutOverRow(overlayLutPre, idx + span->x, bot + span->x, std::min(span->len, updateWidth - span->x));
+                }
+            } else {
+                FKernel::premulLutOverRow(overlayLutPre, idx, bot, updateWidth);
+            }
+        }
+    });
+}
+
+// -------------------------------------------------------------------------------------------------
+FImage* FOverlayPremul::ToImage() const {
+    FImage* outP32 = imgRef->Clone();
+    for (unsigned y = 0; y < height; y++) {
+        FKernel::straightRow((FColor*)outP32->ScanLine(y), width);
+    }
+    return outP32;
+}
+
+// -------------------------------------------------------------------------------------------------
+FOverlay* FOverlayPremul::Clone() const {
+    FOverlayPremul* copy = new FOverlayPremul(width, height, decay);
+    copy->imgRef.reset(imgRef->Clone());
+    return copy;
+}
+
+// =================================================================================================
+//  FOverlayA16
+// =================================================================================================
+
+// -------------------------------------------------------------------------------------------------
+FOverlayA16::FOverlayA16(unsigned width, unsigned height, float decay)
+    : FOverlay(width, height, decay),
+      imgRef(FImage::Allocate(width, height, 32)),
+      alpha16((size_t)width * height, 0) {
+    imgRef->FillImage(FPalette::TRANSPARENT);
+}
+
+// -------------------------------------------------------------------------------------------------
+unsigned FOverlayA16::DecayFrames(float decay) {
+    unsigned scale = (unsigned)(65536 * (double)decay);
+    if (scale >= 65536)
+        return NEVER;
+
+    unsigned frames = 0;
+    for (unsigned alpha = 0xff00; alpha >= 128; alpha = alpha * scale >> 16) {
+        frames++;
+    }
+    return frames;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Decay overlay and blend it over the frame.
+// Frame pixels outside the overlay are expanded, overlay pixels outside the frame only decay.
+void FOverlayA16::Composite(const FColor* frameLut, const FImage& frameI8, FImage& outP32) {
+    unsigned scale = this->scale();
+    unsigned frameHeight = std::min(frameI8.GetHeight(), outP32.GetHeight());
+    unsigned frameWidth = std::min(frameI8.GetWidth(), outP32.GetWidth());
+    unsigned blendWidth = std::min(frameWidth, width);
+
+    const FSpans* frameSpans = BlendFUtil::useSpans ? &frameI8.Spans() : nullptr;
+
+    FThreadPool::get().forBands(std::max(frameHeight, height), std::max(frameWidth, width) * 4, [&](unsigned y0, unsigned y1) {
+        for (unsigned y = y0; y < y1; y++) {
+            FColor* top = nullptr;
+            if (y < height) {
+                top = (FColor*)imgRef->ScanLine(y);
+                FKernel::decayA16Row(&alpha16[(size_t)y * width], top, scale, width);
+            }
+            if (y < frameHeight) {
+                FColor* out = (FColor*)outP32.ScanLine(y);
+                unsigned x0 = 0;
+                if (top != nullptr) {
+                    FKernel::expandBlendRow(frameLut, frameI8.ReadScanLine(y), top, out, blendWidth);
+                    x0 = blendWidth;
+                }
+                BlendFUtil::ExpandI8Row(frameLut, frameI8, frameSpans, y, out, x0, frameWidth);
+            }
+        }
+    });
+}
+
+// -------------------------------------------------------------------------------------------------
+void FOverlayA16::Update(const FColor* overlayLut, const FImage& frameI8) {
+    unsigned updateHeight = std::min(frameI8.GetHeight(), height);
+    unsigned updateWidth = std::min(frameI8.GetWidth(), width);
+
+    // Transparent index 0 runs only clear transparent overlay pixels and are skipped.
+    const FSpans* spans = (BlendFUtil::useSpans && overlayLut[0].rgbReserved == 0) ? &frameI8.Spans() : nullptr;
+
+    FThreadPool::get().forBands(updateHeight, updateWidth * 6, [&](unsigned y0, unsigned y1) {
+        for (unsigned y = y0; y < y1; y++) {
+            const BYTE* idx = frameI8.ReadScanLine(y);
+            FColor* bot = (FColor*)imgRef->ScanLine(y);
+            WORD* alpha = &alpha16[(size_t)y * width];
+            if (spans != nullptr) {
+                for (const FSpan* span = spans->begin(y); span != spans->end(y) && span->x < updateWidth; span++) {
+                    FKernel::lutBlendOverA16Row(overlayLut, idx + span->x, bot + span->x, alpha + span->x,
+                        std::min(span->len, updateWidth - span->x));
+                }
+            } else {
+                FKernel::lutBlendOverA16Row(overlayLut, idx, bot, alpha, updateWidth);
+            }
+        }
+    });
+}
+
+// -------------------------------------------------------------------------------------------------
+FImage* FOverlayA16::ToImage() const {
+    return imgRef->Clone();
+}
+
+// -------------------------------------------------------------------------------------------------
+FOverlay* FOverlayA16::Clone() const {
+    FOverlayA16* copy = new FOverlayA16(width, height, decay);
+    copy->imgRef.reset(imgRef->Clone());
+    copy->alpha16 = alpha16;
+    return copy;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Alpha below 128 rounds to 0 and is replaced by the next Update, so only larger alpha counts.
+bool FOverlayA16::SameHidden(const FOverlay& other) const {
+    const FOverlayA16* otherA16 = dynamic_cast<const FOverlayA16*>(&other);
+    if (otherA16 == nullptr || otherA16->alpha16.size() != alpha16.size())
+        return false;
+    for (size_t idx = 0; idx < alpha16.size(); idx++) {
+        if (alpha16[idx] != otherA16->alpha16[idx] && (alpha16[idx] >= 128 || otherA16->alpha16[idx] >= 128))
+            return false;
+    }
+    return true;
+}
+
+// =================================================================================================
+//  FOverlayPlanar
+// =================================================================================================
+
+// -------------------------------------------------------------------------------------------------
+// True if any byte is not 0.
+static bool AnyByte(const BYTE* row, unsigned width) {
+    unsigned x = 0;
+    uint64_t bits = 0;
+    for (; x + 8 <= width; x += 8) {
+        uint64_t bytes;
+        memcpy(&bytes, row + x, sizeof(bytes));
+        bits |= bytes;
+    }
+    for (; x < width; x++) {
+        bits |= row[x];
+    }
+    return bits != 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Planes start as transparent black, same as FPalette::TRANSPARENT.
+FOverlayPlanar::FOverlayPlanar(unsigned width, unsigned height, float decay)
+    : FOverlay(width, height, decay),
+      planes((size_t)width * height * 4, 0),
+      rowLive(height, 0) {
+}
+
+// -------------------------------------------------------------------------------------------------
+// Decay alpha plane and blend live rows over the frame.
+void FOverlayPlanar::Composite(const FColor* frameLut, const FImage& frameI8, FImage& outP32) {
+    unsigned scale = (unsigned)(256 * decay);
+    unsigned frameHeight = std::min(frameI8.GetHeight(), outP32.GetHeight());
+    unsigned frameWidth = std::min(frameI8.GetWidth(), outP32.GetWidth());
+    unsigned blendWidth = std::min(frameWidth, width);
+
+    const FSpans* frameSpans = BlendFUtil::useSpans ? &frameI8.Spans() : nullptr;
+
+    FThreadPool::get().forBands(std::max(frameHeight, height), std::max(frameWidth, width) * 4, [&](unsigned y0, unsigned y1) {
+        std::vector<FColor> rowBuf(width);
+        for (unsigned y = y0; y < y1; y++) {
+            bool live = (y < height) && rowLive[y];
+            if (live) {
+                FKernel::decayPlaneRow(plane(ALPHA, y), scale, width);
+                rowLive[y] = live = AnyByte(plane(ALPHA, y), width);
+            }
+            if (y < frameHeight) {
+                FColor* out = (FColor*)outP32.ScanLine(y);
+                unsigned x0 = 0;
+                if (live) {
+                    interleave(y, 0, rowBuf.data(), blendWidth);
+                    FKernel::expandBlendRow(frameLut, frameI8.ReadScanLine(y), rowBuf.data(), out, blendWidth);
+                    x0 = blendWidth;
+                }
+                BlendFUtil::ExpandI8Row(frameLut, frameI8, frameSpans, y, out, x0, frameWidth);
+            }
+        }
+    });
+}
+
+// -------------------------------------------------------------------------------------------------
+// Blend frame into overlay, frame spans skip index 0 runs when index 0 maps to transparent.
+// Skipped pixels keep their color, the same as FOverlayP32 except for transparent pixels.
+void FOverlayPlanar::Update(const FColor* overlayLut, const FImage& frameI8) {
+    unsigned updateHeight = std::min(frameI8.GetHeight(), height);
+    unsigned updateWidth = std::min(frameI8.GetWidth(), width);
+    const FSpans* spans = (BlendFUtil::useSpans && overlayLut[0].rgbReserved == 0) ? &frameI8.Spans() : nullptr;
+    const FSpan allSpan = { 0, updateWidth };
+
+    FThreadPool::get().forBands(updateHeight, updateWidth * 4, [&](unsigned y0, unsigned y1) {
+        std::vector<FColor> rowBuf(width);
+        for (unsigned y = y0; y < y1; y++) {
+            const BYTE* idx = frameI8.ReadScanLine(y);
+            const FSpan* span = (spans != nullptr) ? spans->begin(y) : &allSpan;
+            const FSpan* spanEnd = (spans != nullptr) ? spans->end(y) : &allSpan + 1;
+            for (; span != spanEnd && span->x < updateWidth; span++) {
+                unsigned len = std::min(span->len, updateWidth - span->x);
+                interleave(y, span->x, rowBuf.data(), len);
+                FKernel::lutBlendOverRow(overlayLut, idx + span->x, rowBuf.data(), len);
+                deinterleave(rowBuf.data(), y, span->x, len);
+                rowLive[y] = 1;
+            }
+        }
+    });
+}
+
+// -------------------------------------------------------------------------------------------------
+FImage* FOverlayPlanar::ToImage() const {
+    FImage* imgPtr = FImage::Allocate(width, height, 32);
+    for (unsigned y = 0; y < height; y++) {
+        interleave(y, 0, (FColor*)imgPtr->ScanLine(y), width);
+    }
+    return imgPtr;
+}
+
+// -------------------------------------------------------------------------------------------------
+FOverlay* FOverlayPlanar::Clone() const {
+    FOverlayPlanar* copy = new FOverlayPlanar(width, height, decay);
+    copy->planes = planes;
+    copy->rowLive = rowLive;
+    return copy;
+}
+
+// =================================================================================================
+//  FOverlayIndex
+// =================================================================================================
+
+// -------------------------------------------------------------------------------------------------
+FOverlayIndex::FOverlayIndex(unsigned width, unsigned height, float decay)
+    : FOverlay(width, height, decay),
+      indices((size_t)width * height, 0),
+      ages((size_t)width * height, 0),
+      rowLive(height, 0),
+      maxAge(DecayTable(decay, decayTable)) {
+    colors.push_back(FPalette::TRANSPARENT);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Overlay row with alpha decayed by age, returns false if no pixel has alpha.
+bool FOverlayIndex::expandRow(unsigned y, FColor* row) const {
+    const BYTE* index = &indices[(size_t)y * width];
+    const BYTE* age = &ages[(size_t)y * width];
+    bool live = false;
+    for (unsigned x = 0; x < width; x++) {
+        const FColor& color = colors[index[x]];
+        BYTE alpha = decayTable[age[x] * 256 + color.rgbReserved];
+        row[x] = (alpha != 0) ? FColor(color, alpha) : FPalette::TRANSPARENT;
+        live |= (alpha != 0);
+    }
+    return live;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Age live rows one frame, slots whose alpha reached 0 are cleared, and blend them over the frame.
+void FOverlayIndex::Composite(const FColor* frameLut, const FImage& frameI8, FImage& outP32) {
+    unsigned frameHeight = std::min(frameI8.GetHeight(), outP32.GetHeight());
+    unsigned frameWidth = std::min(frameI8.GetWidth(), outP32.GetWidth());
+    unsigned blendWidth = std::min(frameWidth, width);
+
+    const FSpans* frameSpans = BlendFUtil::useSpans ? &frameI8.Spans() : nullptr;
+
+    FThreadPool::get().forBands(std::max(frameHeight, height), std::max(frameWidth, width) * 2, [&](unsigned y0, unsigned y1) {
+        std::vector<FColor> rowBuf(width);
+        for (unsigned y = y0; y < y1; y++) {
+            bool live = (y < height) && rowLive[y];
+            if (live && maxAge != 0) {
+                BYTE* index = &indices[(size_t)y * width];
+                BYTE* age = &ages[(size_t)y * width];
+                for (unsigned x = 0; x < width; x++) {
+                    if (index[x] != 0 && ++age[x] >= maxAge) {
+                        index[x] = 0;
+                        age[x] = 0;
+                    }
+                }
+            }
+            if (live) {
+                rowLive[y] = live = expandRow(y, rowBuf.data());
+            }
+            if (y < frameHeight) {
+                FColor* out = (FColor*)outP32.ScanLine(y);
+                unsigned x0 = 0;
+                if (live) {
+                    FKernel::expandBlendRow(frameLut, frameI8.ReadScanLine(y), rowBuf.data(), out, blendWidth);
+                    x0 = blendWidth;
+                }
+                BlendFUtil::ExpandI8Row(frameLut, frameI8, frameSpans, y, out, x0, frameWidth);
+            }
+        }
+    });
+}
+
+// -------------------------------------------------------------------------------------------------
+// Frame index to overlay slot, colors with alpha are added to the slot colors.
+// A full slot table (255 colors) uses the closest slot color.
+void FOverlayIndex::slotTable(const FColor* overlayLut, BYTE slots[256]) {
+    for (unsigned idx = 0; idx < 256; idx++) {
+        const FColor& color = overlayLut[idx];
+        unsigned slot = 0;
+        if (color.rgbReserved != 0) {
+            slot = colors.findColor(color, 0);
+            if (slot == 0) {
+                if (colors.size() < 256) {
+                    slot = (unsigned)colors.size();
+                    colors.push_back(color);
+                } else {
+                    slot = colors.findClosest(color, 256 * 256L * 3, 0);
+                }
+            }
+        }
+        slots[idx] = (BYTE)slot;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// Frame pixels with an overlay color replace the overlay slot and restart its age.
+// Frame spans skip index 0 runs when index 0 maps to transparent.
+void FOverlayIndex::Update(const FColor* overlayLut, const FImage& frameI8) {
+    unsigned updateHeight = std::min(frameI8.GetHeight(), height);
+    unsigned updateWidth = std::min(frameI8.GetWidth(), width);
+    const FSpans* spans = (BlendFUtil::useSpans && overlayLut[0].rgbReserved == 0) ? &frameI8.Spans() : nullptr;
+    const FSpan allSpan = { 0, updateWidth };
+
+    BYTE slots[256];
+    slotTable(overlayLut, slots);
+
+    FThreadPool::get().forBands(updateHeight, updateWidth * 3, [&](unsigned y0, unsigned y1) {
+        for (unsigned y = y0; y < y1; y++) {
+            const BYTE* idx = frameI8.ReadScanLine(y);
+            BYTE* index = &indices[(size_t)y * width];
+            BYTE* age = &ages[(size_t)y * width];
+            bool wrote = false;
+            const FSpan* span = (spans != nullptr) ? spans->begin(y) : &allSpan;
+            const FSpan* spanEnd = (spans != nullptr) ? spans->end(y) : &allSpan + 1;
+            for (; span != spanEnd && span->x < updateWidth; span++) {
+                unsigned x1 = std::min(span->x + span->len, updateWidth);
+                for (unsigned x = span->x; x < x1; x++) {
+                    BYTE slot = slots[idx[x]];
+                    if (slot != 0) {
+                        index[x] = slot;
+                        age[x] = 0;
+                        wrote = true;
+                    }
+                }
+            }
+            if (wrote) {
+                rowLive[y] = 1;
+            }
+        }
+    });
+}
+
+// -------------------------------------------------------------------------------------------------
+FImage* FOverlayIndex::ToImage() const {
+    FImage* imgPtr = FImage::Allocate(width, height, 32);
+    for (unsigned y = 0; y < height; y++) {
+        expandRow(y, (FColor*)imgPtr->ScanLine(y));
+    }
+    return imgPtr;
+}
+
+// -------------------------------------------------------------------------------------------------
+FOverlay* FOverlayIndex::Clone() const {
+    FOverlayIndex* copy = new FOverlayIndex(width, height, decay);
+    copy->indices = indices;
+    copy->ages = ages;
+    copy->rowLive = rowLive;
+    copy->colors = colors;
+    return copy;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Visible pixels with the same color and age decay the same, slot numbers may differ
+// when the overlays saw different frames.
+bool FOverlayIndex::SameHidden(const FOverlay& other) const {
+    const FOverlayIndex* otherIndex = dynamic_cast<const FOverlayIndex*>(&other);
+    if (otherIndex == nullptr || otherIndex->width != width || otherIndex->height != height)
+        return false;
+    for (size_t idx = 0; idx < indices.size(); idx++) {
+        const FColor& color = colors[indices[idx]];
+        const FColor& otherColor = otherIndex->colors[otherIndex->indices[idx]];
+        if (color.rgbReserved != 0 || otherColor.rgbReserved != 0) {
+            if (color != otherColor || ages[idx] != otherIndex->ages[idx])
+                return false;
+        }
+    }
+    return true;
+}
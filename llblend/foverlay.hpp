@@ -0,0 +1,276 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FOverlay.hpp
+//  Desc: Time lapse overlay which accumulates decaying frames.
+//
+//  FOverlay created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+#include "fimage.hpp"
+#include "blendcfg.hpp"
+#include "fkernel.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Overlay state carried from frame to frame. Each frame:
+//   1. Composite - decay overlay one frame and blend it over the frame,  out = overlay over frameLut[frame]
+//   2. Update    - blend the frame into the overlay,  overlay = overlayLut[frame] over overlay
+class FOverlay {
+public:
+    const unsigned width;
+    const unsigned height;
+    const float decay;
+
+    FOverlay(unsigned _width, unsigned _height, float _decay)
+        : width(_width), height(_height), decay(_decay)
+    { }
+    virtual ~FOverlay() { }
+
+    virtual void Composite(const FColor* frameLut, const FImage& frameI8, FImage& outP32) = 0;
+    virtual void Update(const FColor* overlayLut, const FImage& frameI8) = 0;
+
+    // Output of the last Composite was written by others (layers), drop any state kept about it.
+    virtual void OutputChanged() { }
+
+    // Composite (output not kept) and Update for each frame in order, overlayLuts has 256 entries per frame.
+    virtual void UpdateFrames(const std::vector<const FImage*>& framesI8, const std::vector<FColor>& overlayLuts);
+
+    // Current overlay as a new 32bit image.
+    virtual FImage* ToImage() const = 0;
+    virtual FOverlay* Clone() const = 0;
+
+    // True if overlay state not in ToImage is the same.
+    virtual bool SameHidden(const FOverlay& other) const { return true; }
+
+    static FOverlay* Create(OverlayMode mode, unsigned width, unsigned height, float decay);
+
+    // True if both overlays blend the same from here on, null is an empty overlay.
+    static bool Same(const FOverlay* overlay, const FOverlay* other);
+
+    // Frames until any overlay alpha decays to 0, NEVER if decay is 1.
+    static unsigned DecayFrames(float decay);
+    static constexpr unsigned NEVER = 0xffffffff;
+
+protected:
+    // Alpha [age * 256 + alpha] for age 0..maxAge, returns maxAge (0 if no decay).
+    static unsigned DecayTable(float decay, std::vector<BYTE>& table);
+};
+
+typedef std::unique_ptr<FOverlay> FOverlayRef;
+
+// ---------------------------------------------------------------------------
+// Straight alpha 32bit overlay, every pixel is decayed every frame.
+// UpdateFrames runs all frames over a row while it is in cache, rows only decay between
+// frames that write them, using a table of repeated decays.
+class FOverlayP32 : public FOverlay {
+    FImageRef imgRef;
+
+public:
+    FOverlayP32(unsigned width, unsigned height, float decay);
+
+    void Composite(const FColor* frameLut, const FImage& frameI8, FImage& outP32);
+    void Update(const FColor* overlayLut, const FImage& frameI8);
+    void UpdateFrames(const std::vector<const FImage*>& framesI8, const std::vector<FColor>& overlayLuts);
+    FImage* ToImage() const;
+    FOverlay* Clone() const;
+};
+
+// ---------------------------------------------------------------------------
+// Lazy age based overlay. Stores the color and the frame each pixel was last written.
+// The decayed alpha is looked up from the pixel age when it is composited, so per frame
+// writes only touch the pixels the new frame contributes. Rows with no live pixels are skipped.
+// Output matches FOverlayP32, except the color of fully transparent pixels.
+class FOverlayLazy : public FOverlay {
+    FImageRef baseRef;                  // Pixel color when last written
+    std::vector<unsigned> stamps;       // Frame pixel was last written
+    std::vector<unsigned> rowStamps;    // Frame any pixel in row was last written
+    std::vector<BYTE> decayTable;       // Alpha [age][alpha] for age 0..maxAge
+    unsigned maxAge;                    // All alphas are 0 at maxAge (unless no decay)
+    unsigned frame;
+
+    BYTE decayAlpha(unsigned age, BYTE alpha) const {
+        return decayTable[std::min(age, maxAge) * 256 + alpha];
+    }
+    bool rowLive(unsigned y) const {
+        return rowStamps[y] != NEVER && (maxAge == 0 || frame - rowStamps[y] < maxAge);
+    }
+    void effectiveRow(unsigned y, FColor* row) const;
+
+public:
+    FOverlayLazy(unsigned width, unsigned height, float decay);
+
+    void Composite(const FColor* frameLut, const FImage& frameI8, FImage& outP32);
+    void Update(const FColor* overlayLut, const FImage& frameI8);
+    FImage* ToImage() const;
+    FOverlay* Clone() const;
+};
+
+// ---------------------------------------------------------------------------
+// Sparse tiled 32bit overlay. Tracks which TILE x TILE tiles of the overlay hold
+// visible pixels and which tiles of the frame are not index 0 (transparent).
+// Only tiles live in the overlay or the frame are decayed, blended and written,
+// quiet tiles of the output are left as the previous frame's index 0 fill.
+// Output matches FOverlayP32, except the color of fully transparent pixels.
+class FOverlayTiled : public FOverlay {
+    FImageRef imgRef;
+    unsigned tilesX;
+    unsigned tilesY;
+    std::vector<BYTE> overlayLive;      // Tile has overlay pixels with alpha
+    std::vector<BYTE> frameLive;        // Tile has frame pixels not index 0
+    std::vector<BYTE> outClear;         // Output tile holds index 0 fill color
+    const FImage* lastOut;
+    FColor outColor;                    // Index 0 color of cleared output tiles
+
+    bool sameSize(const FImage& img) const {
+        return img.GetWidth() == width && img.GetHeight() == height;
+    }
+    void frameTiles(const FImage& frameI8);
+
+public:
+    static constexpr unsigned TILE = 64;
+
+    FOverlayTiled(unsigned width, unsigned height, float decay);
+
+    void Composite(const FColor* frameLut, const FImage& frameI8, FImage& outP32);
+    void Update(const FColor* overlayLut, const FImage& frameI8);
+    void OutputChanged() { lastOut = nullptr; }
+    FImage* ToImage() const;
+    FOverlay* Clone() const;
+};
+
+// ---------------------------------------------------------------------------
+// Premultiplied alpha 32bit overlay. Decay scales all four channels and blending is
+// one multiply-add per channel with no alpha tests, straight alpha is only produced
+// for the output and ToImage. Uses standard source over, so partly transparent colors
+// differ slightly from FOverlayP32 which makes a mix of two colors opaque.
+class FOverlayPremul : public FOverlay {
+    FImageRef imgRef;                   // Premultiplied
+
+    static void Premultiply(const FColor* lut, FColor* lutPre);
+
+public:
+    FOverlayPremul(unsigned width, unsigned height, float decay);
+
+    void Composite(const FColor* frameLut, const FImage& frameI8, FImage& outP32);
+    void Update(const FColor* overlayLut, const FImage& frameI8);
+    FImage* ToImage() const;
+    FOverlay* Clone() const;
+};
+
+// ---------------------------------------------------------------------------
+// Straight alpha 32bit overlay with 8.8 fixed point alpha. Decay 0.99 of 8bit alpha is
+// 253/256 truncated, so alpha falls in steps and long decays end early. The 16bit alpha
+// decays by decay * 65536 and is only rounded to 8bit for blending. Colors are not
+// decayed and stay 8bit. Same blend as FOverlayP32.
+class FOverlayA16 : public FOverlay {
+    FImageRef imgRef;                   // Color, alpha is alpha16 rounded to 8bit
+    std::vector<WORD> alpha16;          // 8.8 fixed point alpha
+
+    unsigned scale() const {
+        return (unsigned)(65536 * (double)decay);
+    }
+
+public:
+    FOverlayA16(unsigned width, unsigned height, float decay);
+
+    void Composite(const FColor* frameLut, const FImage& frameI8, FImage& outP32);
+    void Update(const FColor* overlayLut, const FImage& frameI8);
+    FImage* ToImage() const;
+    FOverlay* Clone() const;
+    bool SameHidden(const FOverlay& other) const;
+
+    // Frames until full alpha rounds to 0, NEVER if decay is 1.
+    static unsigned DecayFrames(float decay);
+};
+
+// ---------------------------------------------------------------------------
+// Planar 32bit overlay, separate blue, green, red and alpha planes.
+// Decay only reads and writes the alpha plane, and rows whose alpha plane is all 0
+// are skipped. Blending interleaves the live rows (and frame spans) to BGRA,
+// so output matches FOverlayP32.
+class FOverlayPlanar : public FOverlay {
+    std::vector<BYTE> planes;           // Blue, green, red and alpha planes of width * height
+    std::vector<BYTE> rowLive;          // Row alpha plane may have alpha
+
+    enum { BLUE, GREEN, RED, ALPHA };
+    BYTE* plane(unsigned channel, unsigned y) {
+        return &planes[((size_t)channel * height + y) * width];
+    }
+    const BYTE* plane(unsigned channel, unsigned y) const {
+        return &planes[((size_t)channel * height + y) * width];
+    }
+    void interleave(unsigned y, unsigned x, FColor* out, unsigned count) const {
+        FKernel::interleaveRow(plane(BLUE, y) + x, plane(GREEN, y) + x, plane(RED, y) + x, plane(ALPHA, y) + x, out, count);
+    }
+    void deinterleave(const FColor* in, unsigned y, unsigned x, unsigned count) {
+        FKernel::deinterleaveRow(in, plane(BLUE, y) + x, plane(GREEN, y) + x, plane(RED, y) + x, plane(ALPHA, y) + x, count);
+    }
+
+public:
+    FOverlayPlanar(unsigned width, unsigned height, float decay);
+
+    void Composite(const FColor* frameLut, const FImage& frameI8, FImage& outP32);
+    void Update(const FColor* overlayLut, const FImage& frameI8);
+    FImage* ToImage() const;
+    FOverlay* Clone() const;
+};
+
+// ---------------------------------------------------------------------------
+// Index overlay, 2 bytes per pixel. Each pixel holds a slot into the overlay colors
+// (the overlay palette colors seen, 0 is clear) and its age in frames, the decayed alpha
+// is looked up from the age. Aging and updates are byte operations, RGBA is only made
+// for the rows blended to the output. Selective blend, a frame color replaces the overlay
+// pixel instead of mixing with it, so where overlay colors overlap the newest wins
+// at its own alpha. Elsewhere output matches FOverlayP32.
+class FOverlayIndex : public FOverlay {
+    std::vector<BYTE> indices;          // Slot into colors, 0 clear
+    std::vector<BYTE> ages;             // Frames since the slot was written, < maxAge
+    std::vector<BYTE> rowLive;          // Row may have a visible slot
+    std::vector<BYTE> decayTable;       // Alpha [age][alpha] for age 0..maxAge
+    FPalette colors;                    // Slot colors, [0] transparent
+    unsigned maxAge;                    // All alphas are 0 at maxAge (unless no decay)
+
+    bool expandRow(unsigned y, FColor* row) const;
+    void slotTable(const FColor* overlayLut, BYTE slots[256]);
+
+public:
+    FOverlayIndex(unsigned width, unsigned height, float decay);
+
+    void Composite(const FColor* frameLut, const FImage& frameI8, FImage& outP32);
+    void Update(const FColor* overlayLut, const FImage& frameI8);
+    FImage* ToImage() const;
+    FOverlay* Clone() const;
+    bool SameHidden(const FOverlay& other) const;
+};
@@ -0,0 +1,452 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FPack.cpp
+//  Desc: Packed, memory mapped sequence of 8bit frames for fast replay.
+//
+//  FPack created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+
+#include "fpack.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdlib.h>
+#include <string.h>
+
+const char FPack::EXTN[] = ".llpack";
+
+static const char PACK_MAGIC[8] = { 'L', 'L', 'B', 'P', 'A', 'C', 'K', '\0' };
+static const uint32_t PACK_VERSION = 1;
+static const uint64_t PLANE_ALIGN = 64;
+
+static_assert(sizeof(FPack::Header) == 48, "Pack header layout");
+static_assert(sizeof(FPack::Palette) == 1032, "Pack palette layout");
+static_assert(sizeof(FPack::Frame) == 56, "Pack frame layout");
+
+// =================================================================================================
+//  LZ4 block format, greedy single probe hash match (fast, not the smallest output).
+//  Sequence: token (literal length, match length - 4), literals, 16bit offset. Last 5 bytes
+//  are literals and the last match starts at least 12 bytes before the end.
+// =================================================================================================
+
+static const unsigned LZ4_MIN_MATCH = 4;
+static const size_t LZ4_MF_LIMIT = 12;
+static const size_t LZ4_LAST_LITERALS = 5;
+static const unsigned LZ4_HASH_BITS = 16;
+
+static inline uint32_t Read32(const BYTE* ptr) {
+    uint32_t value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+static inline BYTE* WriteLength(BYTE* out, size_t len) {
+    for (; len >= 255; len -= 255) {
+        *out++ = 255;
+    }
+    *out++ = (BYTE)len;
+    return out;
+}
+
+static BYTE* WriteSequence(BYTE* out, const BYTE* literals, size_t litLen, size_t offset, size_t matchLen) {
+    BYTE* token = out++;
+    *token = (BYTE)((std::min(litLen, (size_t)15) << 4));
+    if (litLen >= 15) {
+        out = WriteLength(out, litLen - 15);
+    }
+    memcpy(out, literals, litLen);
+    out += litLen;
+    if (matchLen != 0) {
+        *out++ = (BYTE)offset;
+        *out++ = (BYTE)(offset >> 8);
+        size_t code = matchLen - LZ4_MIN_MATCH;
+        *token |= (BYTE)std::min(code, (size_t)15);
+        if (code >= 15) {
+            out = WriteLength(out, code - 15);
+        }
+    }
+    return out;
+}
+
+// Worst case output is size + size / 255 + 16.
+static size_t Lz4Compress(const BYTE* src, size_t size, BYTE* dst) {
+    thread_local std::vector<uint32_t> table;
+    table.assign((size_t)1 << LZ4_HASH_BITS, 0);
+
+    BYTE* out = dst;
+    size_t anchor = 0;
+    if (size > LZ4_MF_LIMIT) {
+        const size_t matchLimit = size - LZ4_LAST_LITERALS;
+        const size_t ipLimit = size - LZ4_MF_LIMIT;
+        size_t ip = 0;
+        while (ip <= ipLimit) {
+            uint32_t seq = Read32(src + ip);
+            uint32_t& slot = table[(seq * 2654435761u) >> (32 - LZ4_HASH_BITS)];
+            size_t ref = slot;
+            slot = (uint32_t)ip;
+            if (ref < ip && ip - ref <= 0xffff && Read32(src + ref) == seq) {
+                size_t len = LZ4_MIN_MATCH;
+                while (ip + len < matchLimit && src[ref + len] == src[ip + len]) {
+                    len++;
+                }
+                out = WriteSequence(out, src + anchor, ip - anchor, ip - ref, len);
+                ip += len;
+                anchor = ip;
+            } else {
+                ip += 1 + ((ip - anchor) >> 6);     // Skip faster through data which does not match
+            }
+        }
+    }
+    out = WriteSequence(out, src + anchor, size - anchor, 0, 0);
+    return (size_t)(out - dst);
+}
+
+// False if src is damaged or does not fill dst exactly.
+static bool Lz4Decompress(const BYTE* src, size_t srcSize, BYTE* dst, size_t dstSize) {
+    const BYTE* in = src;
+    const BYTE* inEnd = src + srcSize;
+    BYTE* out = dst;
+    BYTE* outEnd = dst + dstSize;
+
+    auto readLength = [&](size_t& len) {
+        BYTE more;
+        do {
+            if (in >= inEnd)
+                return false;
+            more = *in++;
+            len += more;
+        } while (more == 255);
+        return true;
+    };
+
+    while (in < inEnd) {
+        BYTE token = *in++;
+        size_t litLen = token >> 4;
+        if (litLen == 15 && ! readLength(litLen))
+            return false;
+        if (litLen > (size_t)(inEnd - in) || litLen > (size_t)(outEnd - out))
+            return false;
+        memcpy(out, in, litLen);
+        in += litLen;
+        out += litLen;
+        if (in == inEnd)
+            break;      // Last sequence has no match
+
+        if (inEnd - in < 2)
+            return false;
+        size_t offset = in[0] | ((size_t)in[1] << 8);
+        in += 2;
+        size_t matchLen = token & 15;
+        if (matchLen == 15 && ! readLength(matchLen))
+            return false;
+        matchLen += LZ4_MIN_MATCH;
+        if (offset == 0 || offset > (size_t)(out - dst) || matchLen > (size_t)(outEnd - out))
+            return false;
+
+        const BYTE* ref = out - offset;
+        if (offset >= matchLen) {
+            memcpy(out, ref, matchLen);
+            out += matchLen;
+        } else {
+            for (size_t idx = 0; idx < matchLen; idx++) {
+                *out++ = *ref++;    // Overlapping match repeats the last offset bytes
+            }
+        }
+    }
+    return out == outEnd;
+}
+
+// =================================================================================================
+//  Writer
+// =================================================================================================
+
+// -------------------------------------------------------------------------------------------------
+FPack::Writer::Writer(const char* path, Codec _codec) : file(fopen(path, "wb")), codec(_codec), pos(0) {
+    Header header;
+    memset(&header, 0, sizeof(header));
+    if (file != nullptr && ! write(&header, sizeof(header))) {     // Rewritten by Close
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+FPack::Writer::~Writer() {
+    if (file != nullptr) {
+        fclose(file);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+bool FPack::Writer::write(const void* data, size_t size) {
+    if (size != 0 && fwrite(data, 1, size, file) != size)
+        return false;
+    pos += size;
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Plane is stored raw if LZ4 does not make it smaller.
+bool FPack::Writer::Add(const lstring& name, int64_t time, const FImage& imgI8) {
+    if (file == nullptr || ! imgI8.Valid() || imgI8.GetBitsPerPixel() != 8)
+        return false;
+
+    Palette palette;        // Unused colors are clear
+    FPalette imgPalette;
+    imgI8.getPalette(imgPalette);
+    palette.colors = (uint32_t)std::min(imgPalette.size(), (size_t)256);
+    palette.hasTransparency = imgPalette.hasTransparency;
+    std::copy(imgPalette.begin(), imgPalette.begin() + palette.colors, palette.color);
+
+    Frame frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.width = imgI8.GetWidth();
+    frame.height = imgI8.GetHeight();
+    frame.pitch = imgI8.GetBytesPerLine();
+    frame.time = time;
+    frame.codec = CODEC_RAW;
+    frame.nameOffset = (uint32_t)names.size();
+    frame.nameLen = (uint32_t)name.length();
+    names.insert(names.end(), name.begin(), name.end());
+
+    frame.palette = (uint32_t)palettes.size();
+    for (uint32_t idx = 0; idx < palettes.size(); idx++) {
+        if (memcmp(&palettes[idx], &palette, sizeof(palette)) == 0) {
+            frame.palette = idx;
+            break;
+        }
+    }
+    if (frame.palette == palettes.size()) {
+        palettes.push_back(palette);
+    }
+
+    // FreeImage bits are one block, bottom row first.
+    const BYTE* plane = imgI8.ReadScanLine(0);
+    size_t planeSize = (size_t)frame.pitch * frame.height;
+    thread_local std::vector<BYTE> packed;
+    if (codec == CODEC_LZ4) {
+        packed.resize(planeSize + planeSize / 255 + 16);
+        size_t packedSize = Lz4Compress(plane, planeSize, packed.data());
+        if (packedSize < planeSize) {
+            plane = packed.data();
+            planeSize = packedSize;
+            frame.codec = CODEC_LZ4;
+        }
+    }
+
+    static const BYTE ZEROS[PLANE_ALIGN] = { 0 };
+    if (! write(ZEROS, (size_t)((PLANE_ALIGN - pos % PLANE_ALIGN) % PLANE_ALIGN)))
+        return false;
+    frame.offset = pos;
+    frame.size = planeSize;
+    if (! write(plane, planeSize))
+        return false;
+    frames.push_back(frame);
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool FPack::Writer::Close() {
+    if (file == nullptr)
+        return false;
+
+    static const BYTE ZEROS[8] = { 0 };
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PACK_MAGIC, sizeof(header.magic));
+    header.version = PACK_VERSION;
+    header.frames = (uint32_t)frames.size();
+    header.palettes = (uint32_t)palettes.size();
+
+    bool okay = write(ZEROS, (size_t)((8 - pos % 8) % 8));
+    header.paletteOffset = pos;
+    okay = okay && write(palettes.data(), palettes.size() * sizeof(Palette));
+    header.nameOffset = pos;
+    okay = okay && write(names.data(), names.size());
+    okay = okay && write(ZEROS, (size_t)((8 - pos % 8) % 8));
+    header.frameOffset = pos;
+    okay = okay && write(frames.data(), frames.size() * sizeof(Frame));
+
+    okay = okay && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+    okay = (fclose(file) == 0) && okay;
+    file = nullptr;
+    return okay;
+}
+
+// =================================================================================================
+//  Reader
+// =================================================================================================
+
+static std::mutex packsMutex;
+static std::map<lstring, FPackRef> packs;      // Open packs by path, kept for the run
+
+// -------------------------------------------------------------------------------------------------
+FPack::FPack(const char* path)
+    : map(path, true), frames(nullptr), palettes(nullptr), names(nullptr), valid(false) {
+    memset(&header, 0, sizeof(header));
+    if (! map.Valid() || map.Size() < sizeof(Header))
+        return;
+
+    const BYTE* data = map.Data();
+    const uint64_t size = map.Size();
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) != 0 || header.version != PACK_VERSION
+        || header.paletteOffset > size || header.palettes > (size - header.paletteOffset) / sizeof(Palette)
+        || header.frameOffset > size || header.frames > (size - header.frameOffset) / sizeof(Frame)
+        || header.nameOffset > size || header.paletteOffset % 8 != 0 || header.frameOffset % 8 != 0)
+        return;
+
+    frames = (const Frame*)(data + header.frameOffset);
+    palettes = (const Palette*)(data + header.paletteOffset);
+    names = (const char*)(data + header.nameOffset);
+    for (unsigned idx = 0; idx < header.frames; idx++) {
+        const Frame& frame = frames[idx];
+        if (frame.offset > size || frame.size > size - frame.offset || frame.palette >= header.palettes
+            || header.nameOffset + frame.nameOffset + frame.nameLen > size
+            || frame.pitch < frame.width || (frame.codec == CODEC_RAW && frame.size != (uint64_t)frame.pitch * frame.height))
+            return;
+    }
+    valid = true;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool FPack::IsPack(const lstring& path) {
+    size_t extnLen = strlen(EXTN);
+    return path.length() > extnLen && strcasecmp(path.c_str() + path.length() - extnLen, EXTN) == 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+lstring FPack::Name(unsigned idx) const {
+    return lstring(names + frames[idx].nameOffset, frames[idx].nameLen);
+}
+
+// -------------------------------------------------------------------------------------------------
+bool FPack::AddFrames(const lstring& packPath, std::vector<lstring>& framePaths) {
+    FPackRef packRef;
+    {
+        std::lock_guard<std::mutex> lock(packsMutex);
+        FPackRef& openRef = packs[packPath];
+        if (openRef == nullptr) {
+            openRef.reset(new FPack(packPath));
+        }
+        packRef = openRef;
+    }
+    if (! packRef->Valid()) {
+        std::cerr << "Bad frame pack " << packPath << std::endl;
+        return false;
+    }
+    char idxStr[16];
+    for (unsigned idx = 0; idx < packRef->Count(); idx++) {
+        snprintf(idxStr, sizeof(idxStr), "/%08u/", idx);     // Fixed width, sorts in pack order
+        framePaths.push_back(packPath + idxStr + packRef->Name(idx));
+    }
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Frame path is <pack>/<idx>/<name>, the name must match the frame at idx.
+bool FPack::Load(const lstring& framePath, FImage& imgI8) {
+    size_t nameSlash = framePath.rfind('/');
+    if (nameSlash == lstring::npos || nameSlash == 0)
+        return false;
+    size_t idxSlash = framePath.rfind('/', nameSlash - 1);
+    if (idxSlash == lstring::npos)
+        return false;
+    char* endPtr;
+    unsigned long idx = strtoul(framePath.c_str() + idxSlash + 1, &endPtr, 10);
+    if (endPtr != framePath.c_str() + nameSlash || nameSlash == idxSlash + 1)
+        return false;
+
+    FPackRef packRef;
+    {
+        std::lock_guard<std::mutex> lock(packsMutex);
+        if (packs.empty())
+            return false;
+        auto it = packs.find(lstring(framePath.substr(0, idxSlash)));
+        if (it == packs.end())
+            return false;
+        packRef = it->second;
+    }
+
+    const char* name = framePath.c_str() + nameSlash + 1;
+    size_t nameLen = framePath.length() - nameSlash - 1;
+    if (idx >= packRef->Count())
+        return false;
+    const Frame& frame = packRef->GetFrame((unsigned)idx);
+    if (frame.nameLen != nameLen || memcmp(packRef->names + frame.nameOffset, name, nameLen) != 0)
+        return false;
+    return packRef->LoadFrame((unsigned)idx, imgI8);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Raw planes are wrapped, not copied. The mapping is copy on write, so writes to the image
+// do not reach the pack file.
+bool FPack::LoadFrame(unsigned idx, FImage& imgI8) const {
+    const Frame& frame = frames[idx];
+    BYTE* plane = map.WritableData() + frame.offset;
+
+    imgI8.Close();
+    if (frame.codec == CODEC_RAW) {
+        imgI8.imgPtr = FreeImage_ConvertFromRawBitsEx(FALSE, plane, FIT_BITMAP, frame.width, frame.height,
+            frame.pitch, 8, 0, 0, 0, FALSE);
+        if (! imgI8.Valid())
+            return false;
+    } else if (frame.codec == CODEC_LZ4) {
+        imgI8.imgPtr = FreeImage_Allocate(frame.width, frame.height, 8);
+        if (! imgI8.Valid() || imgI8.GetBytesPerLine() != frame.pitch
+            || ! Lz4Decompress(plane, (size_t)frame.size, imgI8.ScanLine(0), (size_t)frame.pitch * frame.height)) {
+            imgI8.Close();
+            return false;
+        }
+    } else {
+        return false;
+    }
+
+    const Palette& palette = palettes[frame.palette];
+    RGBQUAD* quads = imgI8.Palette();
+    BYTE alphas[256];
+    memset(quads, 0, 256 * sizeof(RGBQUAD));
+    memset(alphas, 0xff, sizeof(alphas));
+    unsigned trnsLen = 0;
+    for (unsigned clr = 0; clr < palette.colors && clr < 256; clr++) {
+        quads[clr] = palette.color[clr];
+        quads[clr].rgbReserved = 0;
+        alphas[clr] = palette.color[clr].rgbReserved;
+        trnsLen = clr + 1;
+    }
+    if (palette.hasTransparency) {
+        imgI8.SetTransparencyTable(alphas, trnsLen);
+    }
+    return true;
+}
@@ -0,0 +1,144 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FPack.hpp
+//  Desc: Packed, memory mapped sequence of 8bit frames for fast replay.
+//
+//  FPack created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#pragma once
+
+#include "fimage.hpp"
+#include "fmapfile.hpp"
+#include "lstring.hpp"
+
+#include <memory>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Frame sequence packed into one file, read back through a copy on write mapping.
+// Layout (little endian):
+//   Header       magic, counts and table offsets
+//   Planes       per frame 8bit indices in FreeImage layout (bottom up, 4 byte aligned rows),
+//                raw or LZ4 block compressed, 64 byte aligned
+//   Palettes     256 colors with alpha, shared by the frames which use the same palette
+//   Names        frame file names
+//   Frame table  per frame plane offset and size, codec, size, palette, timestamp and name
+// Raw planes are not copied, the loaded image points into the mapping.
+// Frames are read by path <pack>/<frame index>/<frame name>, so they replay like the original
+// files, frames with the same name (packed from different directories) stay apart.
+class FPack {
+public:
+    static const char EXTN[];               // ".llpack"
+    enum Codec { CODEC_RAW, CODEC_LZ4 };
+
+    struct Header {
+        char magic[8];                      // "LLBPACK"
+        uint32_t version;
+        uint32_t frames;
+        uint32_t palettes;
+        uint32_t reserved;
+        uint64_t paletteOffset;
+        uint64_t nameOffset;
+        uint64_t frameOffset;
+    };
+    struct Palette {
+        uint32_t colors;
+        uint32_t hasTransparency;
+        FColor color[256];
+    };
+    struct Frame {
+        uint64_t offset;                    // Plane
+        uint64_t size;                      // Plane bytes stored
+        int64_t time;                       // Source file modification time, seconds since 1970
+        uint32_t width;
+        uint32_t height;
+        uint32_t pitch;                     // Plane bytes per row
+        uint32_t codec;
+        uint32_t palette;
+        uint32_t nameOffset;
+        uint32_t nameLen;
+        uint32_t reserved;
+    };
+
+    // ---- Writer, frames added in replay order.
+    class Writer {
+    public:
+        Writer(const char* path, Codec codec);
+        ~Writer();
+        bool Valid() const
+        { return file != nullptr; }
+        bool Add(const lstring& name, int64_t time, const FImage& imgI8);
+        bool Close();
+
+    private:
+        FILE* file;
+        Codec codec;
+        uint64_t pos;
+        std::vector<Frame> frames;
+        std::vector<Palette> palettes;
+        std::vector<char> names;
+
+        bool write(const void* data, size_t size);
+    };
+
+    // ---- Reader
+    static bool IsPack(const lstring& path);
+
+    // Open pack (kept open for the run), adds frame paths <pack>/<idx>/<frame name> in pack order.
+    static bool AddFrames(const lstring& packPath, std::vector<lstring>& framePaths);
+
+    // Load frame by its path from AddFrames, false if path is not a packed frame.
+    static bool Load(const lstring& framePath, FImage& imgI8);
+
+    unsigned Count() const
+    { return header.frames; }
+    const Frame& GetFrame(unsigned idx) const
+    { return frames[idx]; }
+    lstring Name(unsigned idx) const;
+    bool LoadFrame(unsigned idx, FImage& imgI8) const;
+
+    explicit FPack(const char* path);
+    bool Valid() const
+    { return valid; }
+
+private:
+    FMapFile map;
+    Header header;
+    const Frame* frames;
+    const Palette* palettes;
+    const char* names;
+    bool valid;
+};
+
+typedef std::shared_ptr<FPack> FPackRef;
@@ -103,6 +103,17 @@ public:
         return defIdx;
     }
 
+    // Fill 256 entry color lookup table, unused entries are opaque black (same as ConvertTo32Bits).
+    void toTable(FColor table[256]) const {
+        unsigned idx = 0;
+        for (; idx < size() && idx < 256; idx++) {
+            table[idx] = at(idx);
+        }
+        for (; idx < 256; idx++) {
+            table[idx] = BLACK;
+        }
+    }
+
     RGBQUAD* quads() const {
         return (RGBQUAD*)data();  // Cast away const
     }
@@ -0,0 +1,186 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FPipeline.cpp
+//  Desc: Frame pipeline, frames decoded ahead and outputs encoded behind.
+//
+//  FPipeline created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+
+#include "fpipeline.hpp"
+#include "blendfutil.hpp"
+#include "fthreadpool.hpp"
+
+#include <algorithm>
+#include <memory>
+
+// =================================================================================================
+//  Workers
+// =================================================================================================
+
+// -------------------------------------------------------------------------------------------------
+FPipeline::Workers::Workers(unsigned threadCnt) {
+    for (unsigned idx = 0; idx < threadCnt; idx++) {
+        threads.push_back(std::thread(&Workers::workerLoop, this));
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+FPipeline::Workers::~Workers() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wakeCv.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+void FPipeline::Workers::Submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+    }
+    wakeCv.notify_one();
+}
+
+// -------------------------------------------------------------------------------------------------
+void FPipeline::Workers::workerLoop() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeCv.wait(lock, [&] { return quit || ! jobs.empty(); });
+            if (jobs.empty())
+                return;     // Quit once the queue is drained
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+        job();
+    }
+}
+
+// =================================================================================================
+//  FPipeline
+// =================================================================================================
+
+// -------------------------------------------------------------------------------------------------
+FPipeline::FPipeline(const std::vector<lstring>& _paths, const volatile bool& _abortFlag)
+    : depth(std::max(2u, FThreadPool::getThreads())), paths(_paths), abortFlag(_abortFlag),
+      decoders((unsigned)depth), encoders((unsigned)depth) {
+    BlendFUtil::init();
+}
+
+// -------------------------------------------------------------------------------------------------
+// Decodes left by abort are waited on, encodes are finished (their results are not reported).
+FPipeline::~FPipeline() {
+    for (std::future<FImageRef>& decode : decodes) {
+        decode.wait();
+    }
+    for (Pending& pending : encodes) {
+        pending.okay.wait();
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+bool FPipeline::Next(size_t& idx, FImageRef& imgI8Ref) {
+    while (nextFrame < paths.size() && ! abortFlag) {
+        for (; nextDecode < paths.size() && nextDecode < nextFrame + depth; nextDecode++) {
+            const lstring& fullname = paths[nextDecode];
+            auto task = std::make_shared<std::packaged_task<FImageRef()>>([&fullname]() {
+                FImageRef imgI8Ref(new FImage());
+                BlendFUtil::LoadImage(*imgI8Ref, fullname);
+                return imgI8Ref;
+            });
+            decodes.push_back(task->get_future());
+            decoders.Submit([task]() { (*task)(); });
+        }
+        FImageRef decodedRef = decodes.front().get();
+        decodes.pop_front();
+        idx = nextFrame++;
+        if (decodedRef->Valid()) {
+            imgI8Ref = std::move(decodedRef);
+            return true;
+        }
+    }
+    return false;
+}
+
+// -------------------------------------------------------------------------------------------------
+void FPipeline::Encode(FImageRef& outImgRef, const lstring& outName, const EncodeFn& encodeFn, const DoneFn& doneFn) {
+    if (encodes.size() >= depth) {
+        finishEncode();
+    }
+    const FImage* outImg = outImgRef.get();
+    auto task = std::make_shared<std::packaged_task<bool()>>([encodeFn, outImg, outName]() {
+        return encodeFn(*outImg, outName);
+    });
+    encodes.push_back(Pending { task->get_future(), std::move(outImgRef), outName, doneFn });
+    encoders.Submit([task]() { (*task)(); });
+}
+
+// -------------------------------------------------------------------------------------------------
+void FPipeline::finishEncode() {
+    Pending pending = std::move(encodes.front());
+    encodes.pop_front();
+    bool encoded = pending.okay.get();
+    okay = encoded && okay;
+    if (pending.doneFn) {
+        pending.doneFn(encoded, pending.outName);
+    }
+    freeImgs.push_back(std::move(pending.outImgRef));
+}
+
+// -------------------------------------------------------------------------------------------------
+void FPipeline::WaitEncodes() {
+    while (! encodes.empty()) {
+        finishEncode();
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+FImageRef FPipeline::ReuseImage() {
+    FImageRef imgRef;
+    if (! freeImgs.empty()) {
+        imgRef = std::move(freeImgs.back());
+        freeImgs.pop_back();
+    }
+    return imgRef;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool FPipeline::Finish() {
+    WaitEncodes();
+    freeImgs.clear();
+    return okay;
+}
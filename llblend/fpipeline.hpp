@@ -0,0 +1,129 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FPipeline.hpp
+//  Desc: Frame pipeline, frames decoded ahead and outputs encoded behind.
+//
+//  FPipeline created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#pragma once
+
+#include "fimage.hpp"
+#include "lstring.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Bounded frame pipeline around an in order frame stage (blend, window update, ...).
+// Frames are decoded ahead and outputs encoded behind, each on its own long lived worker
+// threads, so per thread buffers (ex: png inflate) are reused across frames.
+// At most depth frames are decoded ahead and depth outputs wait to be encoded.
+//
+//    FPipeline pipeline(paths, abortFlag);
+//    for (size_t idx; pipeline.Next(idx, imgI8Ref); ) {
+//        ... frame stage, output into pipeline.ReuseImage() or a new image
+//        pipeline.Encode(outImgRef, outName, saveFn);
+//    }
+//    okay = pipeline.Finish();
+class FPipeline {
+public:
+    typedef std::function<bool(const FImage& outImg, const lstring& outName)> EncodeFn;
+    typedef std::function<void(bool okay, const lstring& outName)> DoneFn;
+
+    FPipeline(const std::vector<lstring>& paths, const volatile bool& abortFlag);
+    ~FPipeline();
+
+    FPipeline(const FPipeline&) = delete;
+    FPipeline& operator=(const FPipeline&) = delete;
+
+    const size_t depth;
+
+    // Next frame in path order, frames which fail to load are skipped.
+    // False at the end or on abort.
+    bool Next(size_t& idx, FImageRef& imgI8Ref);
+
+    // Encode output behind the frame stage, encodeFn runs on an encode worker.
+    // doneFn (optional) runs on this thread, in Encode order, once the encode finished.
+    void Encode(FImageRef& outImgRef, const lstring& outName, const EncodeFn& encodeFn, const DoneFn& doneFn = nullptr);
+
+    // Wait for the pending encodes, ex: before an encode which must follow the previous ones.
+    void WaitEncodes();
+
+    // Output image of a finished encode to reuse, null if none.
+    FImageRef ReuseImage();
+
+    // Wait for the pending encodes, false if any encode failed.
+    bool Finish();
+
+private:
+    // Long lived threads running queued jobs in order of submission.
+    class Workers {
+    public:
+        explicit Workers(unsigned threadCnt);
+        ~Workers();     // Runs the queued jobs then joins
+        void Submit(std::function<void()> job);
+
+    private:
+        std::vector<std::thread> threads;
+        std::deque<std::function<void()>> jobs;
+        std::mutex mutex;
+        std::condition_variable wakeCv;
+        bool quit = false;
+
+        void workerLoop();
+    };
+
+    struct Pending {
+        std::future<bool> okay;
+        FImageRef outImgRef;
+        lstring outName;
+        DoneFn doneFn;
+    };
+
+    const std::vector<lstring>& paths;
+    const volatile bool& abortFlag;
+    size_t nextFrame = 0;
+    size_t nextDecode = 0;
+    bool okay = true;
+    std::deque<std::future<FImageRef>> decodes;
+    std::deque<Pending> encodes;
+    std::vector<FImageRef> freeImgs;
+    Workers decoders;
+    Workers encoders;
+
+    void finishEncode();
+};
@@ -0,0 +1,759 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FPng.cpp
+//  Desc: Fast path png decode of 8bit palette frames and tunable parallel png encode.
+//
+//  FPng created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+
+#include "fpng.hpp"
+#include "fthreadpool.hpp"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#ifdef HAVE_WIN
+    #define strcasecmp _stricmp
+#endif
+
+int FPng::level = Z_DEFAULT_COMPRESSION;
+FPng::Filter FPng::filter = FPng::FILTER_ADAPTIVE;
+int FPng::strategy = Z_DEFAULT_STRATEGY;
+bool FPng::useFreeImage = false;
+
+static const char* const FILTER_NAMES[] = { "none", "sub", "up", "avg", "paeth", "adaptive" };
+
+// Raw rows deflated per block, blocks are deflated in parallel.
+static const size_t BLOCK_BYTES = 256 * 1024;
+
+static const BYTE PNG_SIGNATURE[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+
+// -------------------------------------------------------------------------------------------------
+static inline unsigned ReadBE32(const BYTE* ptr) {
+    return ((unsigned)ptr[0] << 24) | ((unsigned)ptr[1] << 16) | ((unsigned)ptr[2] << 8) | ptr[3];
+}
+
+static inline bool IsChunk(const BYTE* type, const char* name) {
+    return memcmp(type, name, 4) == 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+// One byte per pixel, so left is the previous byte of the row. prev is null on the first row.
+bool FPng::unfilterRow(BYTE filter, const BYTE* in, const BYTE* prev, BYTE* out, unsigned width) {
+    switch (filter) {
+    case 0:     // None
+        memcpy(out, in, width);
+        return true;
+    case 1:     // Sub
+        out[0] = in[0];
+        for (unsigned x = 1; x < width; x++) {
+            out[x] = (BYTE)(in[x] + out[x - 1]);
+        }
+        return true;
+    case 2:     // Up
+        if (prev == nullptr) {
+            memcpy(out, in, width);
+        } else {
+            for (unsigned x = 0; x < width; x++) {
+                out[x] = (BYTE)(in[x] + prev[x]);
+            }
+        }
+        return true;
+    case 3:     // Average
+        if (prev == nullptr) {
+            out[0] = in[0];
+            for (unsigned x = 1; x < width; x++) {
+                out[x] = (BYTE)(in[x] + (out[x - 1] >> 1));
+            }
+        } else {
+            out[0] = (BYTE)(in[0] + (prev[0] >> 1));
+            for (unsigned x = 1; x < width; x++) {
+                out[x] = (BYTE)(in[x] + ((out[x - 1] + prev[x]) >> 1));
+            }
+        }
+        return true;
+    case 4:     // Paeth, same as Sub on the first row
+        if (prev == nullptr) {
+            out[0] = in[0];
+            for (unsigned x = 1; x < width; x++) {
+                out[x] = (BYTE)(in[x] + out[x - 1]);
+            }
+        } else {
+            out[0] = (BYTE)(in[0] + prev[0]);
+            for (unsigned x = 1; x < width; x++) {
+                int a = out[x - 1];
+                int b = prev[x];
+                int c = prev[x - 1];
+                int pa = abs(b - c);
+                int pb = abs(a - c);
+                int pc = abs(a + b - 2 * c);
+                int pred = (pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c;
+                out[x] = (BYTE)(in[x] + pred);
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool FPng::DecodeI8(const BYTE* png, size_t size, FImage& imgI8, FPalette& palette) {
+    if (size < sizeof(PNG_SIGNATURE) + 25 || memcmp(png, PNG_SIGNATURE, sizeof(PNG_SIGNATURE)) != 0)
+        return false;
+
+    // Walk the chunks, only the header is checked before any pixels are touched.
+    // Buffers are per decode thread (FPipeline workers, thread pool), reused across frames.
+    thread_local std::vector<BYTE> idatBuf;     // Joined IDAT chunks, if more than one
+    thread_local std::vector<BYTE> rawBuf;      // Inflated filter byte + indices per row
+    const BYTE* end = png + size;
+    const BYTE* pos = png + sizeof(PNG_SIGNATURE);
+    unsigned width = 0;
+    unsigned height = 0;
+    const BYTE* plte = nullptr;
+    unsigned plteLen = 0;
+    const BYTE* trns = nullptr;
+    unsigned trnsLen = 0;
+    const BYTE* idat = nullptr;
+    size_t idatLen = 0;
+    bool joined = false;
+
+    while (pos + 12 <= end) {
+        unsigned len = ReadBE32(pos);
+        const BYTE* type = pos + 4;
+        const BYTE* body = pos + 8;
+        if (len > (size_t)(end - body) - 4)
+            return false;
+
+        if (width == 0) {
+            // IHDR must be first, 8bit palette, deflate, adaptive filters, not interlaced.
+            if (! IsChunk(type, "IHDR") || len != 13 || body[8] != 8 || body[9] != 3
+                || body[10] != 0 || body[11] != 0 || body[12] != 0)
+                return false;
+            width = ReadBE32(body);
+            height = ReadBE32(body + 4);
+            if (width == 0 || height == 0 || ((uint64_t)width + 1) * height > 0xffffffffu)
+                return false;
+        } else if (IsChunk(type, "IDAT")) {
+            if (idat == nullptr) {
+                idat = body;
+                idatLen = len;
+            } else {
+                if (! joined) {
+                    idatBuf.assign(idat, idat + idatLen);
+                    joined = true;
+                }
+                idatBuf.insert(idatBuf.end(), body, body + len);
+            }
+        } else if (IsChunk(type, "PLTE")) {
+            plte = body;
+            plteLen = len / 3;
+        } else if (IsChunk(type, "tRNS")) {
+            trns = body;
+            trnsLen = len;
+        } else if (IsChunk(type, "IEND")) {
+            break;
+        } else if (IsChunk(type, "gAMA") || (type[0] & 0x20) == 0) {
+            return false;   // Gamma corrected or unknown critical chunk
+        }
+        pos = body + len + 4;  // Skip crc
+    }
+    if (width == 0 || plte == nullptr || plteLen == 0 || plteLen > 256 || trnsLen > plteLen || idat == nullptr)
+        return false;
+    if (joined) {
+        idat = idatBuf.data();
+        idatLen = idatBuf.size();
+    }
+
+    // Inflate all rows at once, a short or damaged stream falls back to FreeImage.
+    size_t rowBytes = (size_t)width + 1;
+    rawBuf.resize(rowBytes * height);
+    DWORD rawLen = FreeImage_ZLibUncompress(rawBuf.data(), (DWORD)rawBuf.size(), (BYTE*)idat, (DWORD)idatLen);
+    if (rawLen != rawBuf.size())
+        return false;
+
+    if (! imgI8.Valid() || imgI8.GetBitsPerPixel() != 8 || imgI8.GetWidth() != width || imgI8.GetHeight() != height) {
+        imgI8.Close();
+        imgI8.imgPtr = FreeImage_Allocate(width, height, 8);
+        if (! imgI8.Valid())
+            return false;
+    }
+    imgI8.ClearSpans();
+
+    // Png rows are top down, FreeImage scan lines bottom up.
+    const BYTE* prev = nullptr;
+    for (unsigned y = 0; y < height; y++) {
+        const BYTE* raw = &rawBuf[y * rowBytes];
+        BYTE* out = imgI8.ScanLine(height - 1 - y);
+        if (! unfilterRow(raw[0], raw + 1, prev, out, width)) {
+            imgI8.Close();
+            return false;
+        }
+        prev = out;
+    }
+
+    // Same palette and transparency FreeImage gives a palette png.
+    BYTE alphas[256];
+    memset(alphas, 0xff, sizeof(alphas));
+    if (trns != nullptr) {
+        memcpy(alphas, trns, trnsLen);
+    }
+    palette.clear();
+    palette.hasTransparency = trns != nullptr;
+    RGBQUAD* quads = imgI8.Palette();
+    memset(quads, 0, 256 * sizeof(RGBQUAD));
+    for (unsigned idx = 0; idx < plteLen; idx++) {
+        const BYTE* rgb = plte + idx * 3;
+        palette.push_back(FColor(rgb[0], rgb[1], rgb[2], alphas[idx]));
+        quads[idx] = palette.back();
+        quads[idx].rgbReserved = 0;
+    }
+    if (trns != nullptr) {
+        imgI8.SetTransparencyTable(trns, trnsLen);
+    } else {
+        FreeImage_SetTransparent(imgI8.imgPtr, FALSE);
+    }
+    return true;
+}
+
+// =================================================================================================
+//  Encode
+// =================================================================================================
+
+// -------------------------------------------------------------------------------------------------
+// Encoder profile, fast, default, small, freeimage or <level>[,<filter>]
+//   fast      level 1, sub filter, run length matches only (Z_RLE)
+//   default   level 6, adaptive filter (same as FreeImage)
+//   small     level 9, adaptive filter
+//   freeimage FreeImage_Save at the current level
+bool FPng::setEncode(const char* spec) {
+    if (strcasecmp(spec, "fast") == 0) {
+        level = 1;
+        filter = FILTER_SUB;
+        strategy = Z_RLE;
+        useFreeImage = false;
+        return true;
+    } else if (strcasecmp(spec, "default") == 0) {
+        level = Z_DEFAULT_COMPRESSION;
+        filter = FILTER_ADAPTIVE;
+        strategy = Z_DEFAULT_STRATEGY;
+        useFreeImage = false;
+        return true;
+    } else if (strcasecmp(spec, "small") == 0) {
+        level = 9;
+        filter = FILTER_ADAPTIVE;
+        strategy = Z_DEFAULT_STRATEGY;
+        useFreeImage = false;
+        return true;
+    } else if (strcasecmp(spec, "freeimage") == 0) {
+        useFreeImage = true;
+        return true;
+    }
+
+    char* endPtr;
+    long value = strtol(spec, &endPtr, 10);
+    if (endPtr != spec && value >= 0 && value <= 9 && (*endPtr == '\0' || *endPtr == ',')) {
+        Filter newFilter = filter;
+        bool okay = (*endPtr == '\0');
+        for (unsigned idx = 0; ! okay && idx <= FILTER_ADAPTIVE; idx++) {
+            if (strcasecmp(endPtr + 1, FILTER_NAMES[idx]) == 0) {
+                newFilter = (Filter)idx;
+                okay = true;
+            }
+        }
+        if (okay) {
+            level = (int)value;
+            filter = newFilter;
+            strategy = Z_DEFAULT_STRATEGY;
+            return true;
+        }
+    }
+    std::cerr << "Bad png encode " << spec << ", expect fast, default, small, freeimage or <level>[,<filter>],"
+        " level 0..9, filter none, sub, up, avg, paeth or adaptive" << std::endl;
+    return false;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Filter type byte then filtered row, bpp is bytes per pixel. prev is null on the first row.
+void FPng::filterRow(Filter rowFilter, const BYTE* row, const BYTE* prev, unsigned rowBytes, unsigned bpp, BYTE* out) {
+    if (rowFilter == FILTER_ADAPTIVE) {
+        // Smallest sum of filtered bytes as signed values, same heuristic as libpng.
+        thread_local std::vector<BYTE> trial;
+        trial.resize(rowBytes + 1);
+        unsigned long bestSum = ~0ul;
+        for (unsigned type = FILTER_NONE; type < FILTER_ADAPTIVE; type++) {
+            filterRow((Filter)type, row, prev, rowBytes, bpp, trial.data());
+            unsigned long sum = 0;
+            for (unsigned x = 1; x <= rowBytes; x++) {
+                sum += (unsigned)abs((signed char)trial[x]);
+            }
+            if (sum < bestSum) {
+                bestSum = sum;
+                memcpy(out, trial.data(), rowBytes + 1);
+            }
+        }
+        return;
+    }
+
+    out[0] = (BYTE)rowFilter;
+    out++;
+    switch (rowFilter) {
+    case FILTER_SUB:
+        for (unsigned x = 0; x < rowBytes; x++) {
+            out[x] = (BYTE)(row[x] - ((x >= bpp) ? row[x - bpp] : 0));
+        }
+        break;
+    case FILTER_UP:
+        for (unsigned x = 0; x < rowBytes; x++) {
+            out[x] = (BYTE)(row[x] - ((prev != nullptr) ? prev[x] : 0));
+        }
+        break;
+    case FILTER_AVG:
+        for (unsigned x = 0; x < rowBytes; x++) {
+            unsigned left = (x >= bpp) ? row[x - bpp] : 0;
+            unsigned up = (prev != nullptr) ? prev[x] : 0;
+            out[x] = (BYTE)(row[x] - ((left + up) >> 1));
+        }
+        break;
+    case FILTER_PAETH:
+        for (unsigned x = 0; x < rowBytes; x++) {
+            int a = (x >= bpp) ? row[x - bpp] : 0;
+            int b = (prev != nullptr) ? prev[x] : 0;
+            int c = (x >= bpp && prev != nullptr) ? prev[x - bpp] : 0;
+            int pa = abs(b - c);
+            int pb = abs(a - c);
+            int pc = abs(a + b - 2 * c);
+            int pred = (pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c;
+            out[x] = (BYTE)(row[x] - pred);
+        }
+        break;
+    default:
+        memcpy(out, row, rowBytes);
+        break;
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// Raw deflate of one block. Blocks other than the last end with a sync flush, so the next
+// block starts on a byte boundary and the blocks join into one deflate stream.
+bool FPng::deflateBlock(const BYTE* data, size_t size, bool last, std::vector<BYTE>& out) {
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (deflateInit2(&strm, level, Z_DEFLATED, -MAX_WBITS, 8, strategy) != Z_OK)
+        return false;
+
+    out.resize(deflateBound(&strm, (uLong)size) + 16);  // Room for the sync flush marker
+    strm.next_in = (Bytef*)data;
+    strm.avail_in = (uInt)size;
+    strm.next_out = out.data();
+    strm.avail_out = (uInt)out.size();
+    int result = deflate(&strm, last ? Z_FINISH : Z_SYNC_FLUSH);
+    bool okay = last ? (result == Z_STREAM_END) : (result == Z_OK && strm.avail_in == 0 && strm.avail_out != 0);
+    out.resize(strm.total_out);
+    deflateEnd(&strm);
+    return okay;
+}
+
+// -------------------------------------------------------------------------------------------------
+static void AppendBE32(std::vector<BYTE>& png, unsigned value) {
+    BYTE bytes[4] = { (BYTE)(value >> 24), (BYTE)(value >> 16), (BYTE)(value >> 8), (BYTE)value };
+    png.insert(png.end(), bytes, bytes + 4);
+}
+
+// Chunk of the pieces, crc covers type and data.
+static void AppendChunk(std::vector<BYTE>& png, const char* type,
+    const BYTE* data1, size_t len1, const BYTE* data2 = nullptr, size_t len2 = 0, const BYTE* data3 = nullptr, size_t len3 = 0) {
+    AppendBE32(png, (unsigned)(len1 + len2 + len3));
+    png.insert(png.end(), type, type + 4);
+    uLong crc = crc32(0, (const Bytef*)type, 4);
+    const BYTE* datas[3] = { data1, data2, data3 };
+    size_t lens[3] = { len1, len2, len3 };
+    for (unsigned idx = 0; idx < 3; idx++) {
+        if (lens[idx] != 0) {
+            png.insert(png.end(), datas[idx], datas[idx] + lens[idx]);
+            crc = crc32(crc, datas[idx], (uInt)lens[idx]);
+        }
+    }
+    AppendBE32(png, (unsigned)crc);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Png rows are top down RGBA (or indices), FreeImage scan lines bottom up BGRA.
+// Rectangle x0,y0 is from the top left, parts get one zlib stream split at the block ends.
+bool FPng::encodeData(const FImage& img, unsigned x0, unsigned y0, unsigned width, unsigned height,
+    std::vector<std::vector<BYTE>>& parts) {
+    const unsigned imgHeight = img.GetHeight();
+    const unsigned bpp = img.GetBitsPerPixel() / 8;
+    const size_t rowBytes = (size_t)width * bpp;
+    const size_t lineBytes = rowBytes + 1;
+    const unsigned blockRows = (unsigned)std::max((size_t)1, BLOCK_BYTES / lineBytes);
+    const unsigned blocks = (height + blockRows - 1) / blockRows;
+
+    auto readRow = [&](unsigned y, BYTE* row) {
+        const BYTE* line = img.ReadScanLine(imgHeight - 1 - (y0 + y)) + (size_t)x0 * bpp;
+        if (bpp == 1) {
+            memcpy(row, line, rowBytes);
+            return;
+        }
+        const RGBQUAD* quads = (const RGBQUAD*)line;
+        for (unsigned x = 0; x < width; x++, row += 4) {
+            row[0] = quads[x].rgbRed;
+            row[1] = quads[x].rgbGreen;
+            row[2] = quads[x].rgbBlue;
+            row[3] = quads[x].rgbReserved;
+        }
+    };
+
+    parts.assign(blocks, std::vector<BYTE>());
+    std::vector<uLong> adlers(blocks);
+    std::vector<size_t> sizes(blocks);
+    std::atomic<bool> okay(true);
+    FThreadPool::get().forEach(blocks, [&](unsigned block) {
+        unsigned y0 = block * blockRows;
+        unsigned y1 = std::min(height, y0 + blockRows);
+
+        // Row before the block (for up, avg and paeth) then the block rows.
+        std::vector<BYTE> rows((size_t)(y1 - y0 + 1) * rowBytes);
+        std::vector<BYTE> filtered((size_t)(y1 - y0) * lineBytes);
+        for (unsigned y = (y0 > 0) ? y0 - 1 : y0; y < y1; y++) {
+            readRow(y, &rows[(size_t)(y + 1 - y0) * rowBytes]);
+        }
+        for (unsigned y = y0; y < y1; y++) {
+            const BYTE* prev = (y > 0) ? &rows[(size_t)(y - y0) * rowBytes] : nullptr;
+            filterRow(filter, &rows[(size_t)(y + 1 - y0) * rowBytes], prev, (unsigned)rowBytes, bpp,
+                &filtered[(size_t)(y - y0) * lineBytes]);
+        }
+
+        adlers[block] = adler32(adler32(0, nullptr, 0), filtered.data(), (uInt)filtered.size());
+        sizes[block] = filtered.size();
+        if (! deflateBlock(filtered.data(), filtered.size(), block + 1 == blocks, parts[block])) {
+            okay = false;
+        }
+    });
+    if (! okay || blocks == 0)
+        return false;
+
+    uLong adler = adlers[0];
+    for (unsigned block = 1; block < blocks; block++) {
+        adler = adler32_combine(adler, adlers[block], (z_off_t)sizes[block]);
+    }
+
+    // Zlib header in the first part and adler32 in the last.
+    const BYTE zlibHeader[2] = { 0x78, (BYTE)((level == 0 || level == 1) ? 0x01 : (level >= 2 && level <= 5) ? 0x5e : (level >= 7) ? 0xda : 0x9c) };
+    const BYTE adlerBytes[4] = { (BYTE)(adler >> 24), (BYTE)(adler >> 16), (BYTE)(adler >> 8), (BYTE)adler };
+    parts.front().insert(parts.front().begin(), zlibHeader, zlibHeader + sizeof(zlibHeader));
+    parts.back().insert(parts.back().end(), adlerBytes, adlerBytes + sizeof(adlerBytes));
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Signature, IHDR and for 8bit images PLTE and tRNS.
+void FPng::appendHeader(const FImage& img, std::vector<BYTE>& png) {
+    const unsigned bpp = img.GetBitsPerPixel() / 8;
+    png.clear();
+    png.insert(png.end(), PNG_SIGNATURE, PNG_SIGNATURE + sizeof(PNG_SIGNATURE));
+
+    BYTE header[13];
+    BYTE* pos = header;
+    for (unsigned value : { img.GetWidth(), img.GetHeight() }) {
+        *pos++ = (BYTE)(value >> 24);
+        *pos++ = (BYTE)(value >> 16);
+        *pos++ = (BYTE)(value >> 8);
+        *pos++ = (BYTE)value;
+    }
+    *pos++ = 8;                         // Bit depth
+    *pos++ = (bpp == 1) ? 3 : 6;        // Palette or RGBA
+    *pos++ = 0;                         // Deflate
+    *pos++ = 0;                         // Adaptive filters
+    *pos++ = 0;                         // Not interlaced
+    AppendChunk(png, "IHDR", header, sizeof(header));
+
+    if (bpp == 1) {
+        FPalette palette;
+        img.getPalette(palette);
+        BYTE plte[256 * 3];
+        BYTE trns[256];
+        unsigned colors = (unsigned)std::min(palette.size(), (size_t)256);
+        unsigned trnsLen = 0;
+        for (unsigned idx = 0; idx < colors; idx++) {
+            plte[idx * 3] = palette[idx].rgbRed;
+            plte[idx * 3 + 1] = palette[idx].rgbGreen;
+            plte[idx * 3 + 2] = palette[idx].rgbBlue;
+            trns[idx] = palette[idx].rgbReserved;
+            if (trns[idx] != 0xff) {
+                trnsLen = idx + 1;      // Trailing opaque entries left out
+            }
+        }
+        if (colors == 0) {
+            plte[0] = plte[1] = plte[2] = 0;
+            colors = 1;
+        }
+        AppendChunk(png, "PLTE", plte, colors * 3);
+        if (palette.hasTransparency && trnsLen != 0) {
+            AppendChunk(png, "tRNS", trns, trnsLen);
+        }
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+bool FPng::Encode(const FImage& img, std::vector<BYTE>& png) {
+    unsigned bitsPerPixel = img.Valid() ? img.GetBitsPerPixel() : 0;
+    if (bitsPerPixel != 32 && bitsPerPixel != 8)
+        return false;
+
+    std::vector<std::vector<BYTE>> parts;
+    if (! encodeData(img, 0, 0, img.GetWidth(), img.GetHeight(), parts))
+        return false;
+
+    appendHeader(img, png);
+    for (const std::vector<BYTE>& part : parts) {
+        AppendChunk(png, "IDAT", part.data(), part.size());     // One IDAT per block
+    }
+    AppendChunk(png, "IEND", nullptr, 0);
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool FPng::Save(const FImage& img, const char* path) {
+    thread_local std::vector<BYTE> png;    // Reused by each encode thread
+    if (! Encode(img, png))
+        return false;
+
+    FILE* file = fopen(path, "wb");
+    if (file == nullptr)
+        return false;
+    bool okay = fwrite(png.data(), 1, png.size(), file) == png.size();
+    okay = (fclose(file) == 0) && okay;
+    return okay;
+}
+
+// =================================================================================================
+//  Animated png
+// =================================================================================================
+
+static const BYTE DISPOSE_OP_NONE = 0;
+static const BYTE BLEND_OP_SOURCE = 0;
+static const BYTE BLEND_OP_OVER = 1;
+static const unsigned MAX_DELAY_MS = 0xffff;     // fcTL delay_num is 16 bit
+
+// -------------------------------------------------------------------------------------------------
+FApng::FApng(const char* path, unsigned _delayMs)
+    : file(fopen(path, "wb")), delayMs(std::min(std::max(_delayMs, 1u), MAX_DELAY_MS)) {
+}
+
+// -------------------------------------------------------------------------------------------------
+FApng::~FApng() {
+    if (file != nullptr) {
+        Close();
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+bool FApng::write(const std::vector<BYTE>& data) {
+    return fwrite(data.data(), 1, data.size(), file) == data.size();
+}
+
+// -------------------------------------------------------------------------------------------------
+bool FApng::writePending() {
+    if (pendingData.empty())
+        return true;
+
+    BYTE fctl[26];
+    BYTE* pos = fctl;
+    for (unsigned value : { pending.sequence, pending.width, pending.height, pending.x, pending.y }) {
+        *pos++ = (BYTE)(value >> 24);
+        *pos++ = (BYTE)(value >> 16);
+        *pos++ = (BYTE)(value >> 8);
+        *pos++ = (BYTE)value;
+    }
+    for (unsigned value : { pending.delay, 1000u }) {      // Delay fraction of a second
+        *pos++ = (BYTE)(value >> 8);
+        *pos++ = (BYTE)value;
+    }
+    *pos++ = DISPOSE_OP_NONE;
+    *pos++ = pending.blendOp;
+
+    std::vector<BYTE> chunk;
+    AppendChunk(chunk, "fcTL", fctl, sizeof(fctl));
+    bool written = write(chunk) && write(pendingData);
+    pendingData.clear();
+    return written;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool FApng::Add(const FImage& imgP32) {
+    if (file == nullptr || ! imgP32.Valid() || imgP32.GetBitsPerPixel() != 32)
+        return false;
+
+    const unsigned width = imgP32.GetWidth();
+    const unsigned height = imgP32.GetHeight();
+    FrameCtl ctl { 0, width, height, 0, 0, delayMs, BLEND_OP_SOURCE };
+    std::vector<std::vector<BYTE>> parts;
+
+    if (canvasRef == nullptr) {
+        // Default image is the first frame, acTL frame count is written by Close.
+        std::vector<BYTE> header;
+        FPng::appendHeader(imgP32, header);
+        actlPos = (long)header.size();
+        const BYTE actl[8] = { 0 };         // Frames, plays (0 loops forever)
+        AppendChunk(header, "acTL", actl, sizeof(actl));
+        okay = write(header) && okay;
+
+        if (! FPng::encodeData(imgP32, 0, 0, width, height, parts))
+            return okay = false;
+        ctl.sequence = sequence++;
+        for (const std::vector<BYTE>& part : parts) {
+            AppendChunk(pendingData, "IDAT", part.data(), part.size());
+        }
+        canvasRef.reset(FImage::Allocate(width, height, 32));
+        memcpy(canvasRef->ScanLine(0), imgP32.ReadScanLine(0), (size_t)imgP32.GetBytesPerLine() * height);
+    } else {
+        FImage& canvas = *canvasRef;
+        if (width != canvas.GetWidth() || height != canvas.GetHeight()) {
+            std::cerr << "Animation frames must be " << canvas.GetWidth() << "x" << canvas.GetHeight() << std::endl;
+            return false;
+        }
+
+        // Bounding box of the changed pixels in scan lines (bottom up).
+        unsigned minX = width, maxX = 0, minY = height, maxY = 0;
+        bool opaque = true;
+        std::mutex boxMutex;
+        FThreadPool::get().forBands(height, width * 4, [&](unsigned y0, unsigned y1) {
+            unsigned bandMinX = width, bandMaxX = 0, bandMinY = height, bandMaxY = 0;
+            bool bandOpaque = true;
+            for (unsigned y = y0; y < y1; y++) {
+                const uint32_t* cur = (const uint32_t*)imgP32.ReadScanLine(y);
+                const uint32_t* prev = (const uint32_t*)canvas.ReadScanLine(y);
+                if (memcmp(cur, prev, (size_t)width * 4) == 0)
+                    continue;
+                unsigned x0 = 0;
+                while (cur[x0] == prev[x0]) x0++;
+                unsigned x1 = width - 1;
+                while (cur[x1] == prev[x1]) x1--;
+                for (unsigned x = x0; x <= x1 && bandOpaque; x++) {
+                    if (cur[x] != prev[x] && ((const RGBQUAD*)cur)[x].rgbReserved != 0xff) {
+                        bandOpaque = false;
+                    }
+                }
+                bandMinX = std::min(bandMinX, x0);
+                bandMaxX = std::max(bandMaxX, x1);
+                bandMinY = std::min(bandMinY, y);
+                bandMaxY = y;
+            }
+            std::lock_guard<std::mutex> lock(boxMutex);
+            minX = std::min(minX, bandMinX);
+            maxX = std::max(maxX, bandMaxX);
+            minY = std::min(minY, bandMinY);
+            maxY = std::max(maxY, bandMaxY);
+            opaque = opaque && bandOpaque;
+        });
+
+        if (minY > maxY) {
+            if (pending.delay + delayMs <= MAX_DELAY_MS) {
+                pending.delay += delayMs;       // Same as previous frame
+                return okay;
+            }
+            minX = maxX = minY = maxY = 0;      // Delay is full, repeat one pixel
+            opaque = false;
+        }
+
+        ctl.x = minX;
+        ctl.y = height - 1 - maxY;
+        ctl.width = maxX - minX + 1;
+        ctl.height = maxY - minY + 1;
+        if (opaque) {
+            // Changed pixels over the canvas, unchanged pixels clear.
+            ctl.blendOp = BLEND_OP_OVER;
+            FImageRef boxRef(FImage::Allocate(ctl.width, ctl.height, 32));
+            FImage& box = *boxRef;
+            FThreadPool::get().forBands(ctl.height, ctl.width * 4, [&](unsigned y0, unsigned y1) {
+                for (unsigned y = y0; y < y1; y++) {
+                    const uint32_t* cur = (const uint32_t*)imgP32.ReadScanLine(minY + y) + minX;
+                    const uint32_t* prev = (const uint32_t*)canvas.ReadScanLine(minY + y) + minX;
+                    uint32_t* out = (uint32_t*)box.ScanLine(y);
+                    for (unsigned x = 0; x < ctl.width; x++) {
+                        out[x] = (cur[x] != prev[x]) ? cur[x] : 0;
+                    }
+                }
+            });
+            if (! FPng::encodeData(box, 0, 0, ctl.width, ctl.height, parts))
+                return okay = false;
+        } else if (! FPng::encodeData(imgP32, ctl.x, ctl.y, ctl.width, ctl.height, parts)) {
+            return okay = false;
+        }
+
+        okay = writePending() && okay;
+        ctl.sequence = sequence++;
+        for (const std::vector<BYTE>& part : parts) {
+            const BYTE seq[4] = { (BYTE)(sequence >> 24), (BYTE)(sequence >> 16), (BYTE)(sequence >> 8), (BYTE)sequence };
+            sequence++;
+            AppendChunk(pendingData, "fdAT", seq, sizeof(seq), part.data(), part.size());
+        }
+        for (unsigned y = minY; y <= maxY; y++) {
+            memcpy((uint32_t*)canvas.ScanLine(y) + minX, (const uint32_t*)imgP32.ReadScanLine(y) + minX, (size_t)ctl.width * 4);
+        }
+    }
+
+    pending = ctl;
+    frames++;
+    return okay;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool FApng::Close() {
+    if (file == nullptr)
+        return false;
+
+    okay = (frames != 0) && writePending() && okay;
+    std::vector<BYTE> chunk;
+    AppendChunk(chunk, "IEND", nullptr, 0);
+    okay = okay && write(chunk);
+
+    if (okay) {
+        const BYTE actl[8] = { (BYTE)(frames >> 24), (BYTE)(frames >> 16), (BYTE)(frames >> 8), (BYTE)frames, 0, 0, 0, 0 };
+        chunk.clear();
+        AppendChunk(chunk, "acTL", actl, sizeof(actl));
+        okay = fseek(file, actlPos, SEEK_SET) == 0 && write(chunk);
+    }
+    okay = (fclose(file) == 0) && okay;
+    file = nullptr;
+    canvasRef.reset();
+    return okay;
+}
@@ -0,0 +1,138 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FPng.hpp
+//  Desc: Fast path png decode of 8bit palette frames and tunable parallel png encode.
+//
+//  FPng created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#pragma once
+
+#include "fimage.hpp"
+#include "fpalette.hpp"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Png decode of exactly the frames we blend: 8bit palette, not interlaced, optional tRNS.
+// IDAT is inflated in one call into a per thread buffer (reused across frames) and rows are
+// unfiltered straight into the scan lines of imgI8, so there is no generic FIBITMAP conversion.
+// Anything else returns false without reading pixels, and the caller falls back to FreeImage.
+//
+// Png encode of 32bit (RGBA) and 8bit palette images with selectable zlib level, row filter
+// and zlib strategy. Rows are filtered and deflated in independent blocks in parallel,
+// each block ends on a byte boundary (sync flush) so the blocks join into one zlib stream
+// whose adler32 is combined from the block checksums.
+class FPng {
+public:
+    // Decode png in memory into imgI8 (reused if already 8bit of the same size).
+    // palette gets the PLTE colors with tRNS alpha (255 past the end of tRNS).
+    // Images with gAMA are left to FreeImage, which gamma corrects their palette.
+    static bool DecodeI8(const BYTE* png, size_t size, FImage& imgI8, FPalette& palette);
+
+    enum Filter { FILTER_NONE, FILTER_SUB, FILTER_UP, FILTER_AVG, FILTER_PAETH, FILTER_ADAPTIVE };
+
+    static int level;           // zlib level 0..9
+    static Filter filter;       // Row filter, adaptive picks the smallest sum of bytes per row
+    static int strategy;        // zlib strategy, Z_RLE for the fast profile
+    static bool useFreeImage;   // Save with FreeImage_Save, level mapped to its PNG flags
+
+    // Encoder profile, fast, default, small, freeimage or <level>[,<filter>]
+    //   ex: fast  6,paeth  9,adaptive
+    static bool setEncode(const char* spec);
+
+    // Encode 32bit or 8bit image as png, false for other images.
+    static bool Encode(const FImage& img, std::vector<BYTE>& png);
+
+    // Encode and write png file, false if not encoded or not written.
+    static bool Save(const FImage& img, const char* path);
+
+private:
+    friend class FApng;
+
+    static bool unfilterRow(BYTE filter, const BYTE* in, const BYTE* prev, BYTE* out, unsigned width);
+    static void filterRow(Filter filter, const BYTE* row, const BYTE* prev, unsigned rowBytes, unsigned bpp, BYTE* out);
+    static bool deflateBlock(const BYTE* data, size_t size, bool last, std::vector<BYTE>& out);
+    static bool encodeData(const FImage& img, unsigned x0, unsigned y0, unsigned width, unsigned height,
+        std::vector<std::vector<BYTE>>& parts);
+    static void appendHeader(const FImage& img, std::vector<BYTE>& png);
+};
+
+// ---------------------------------------------------------------------------
+// Animated png of 32bit frames written as they are added, one file for a whole run.
+// Each frame after the first only holds the bounding box of the pixels which changed from
+// the previous frame, the canvas is kept (dispose none). When every changed pixel is opaque
+// the box is blended over the canvas with its unchanged pixels clear, which deflates to
+// almost nothing, else the box replaces the canvas (blend source). A frame the same as the
+// previous one lengthens the previous frame delay. Frames are encoded with the FPng settings.
+class FApng {
+public:
+    FApng(const char* path, unsigned delayMs);
+    ~FApng();
+
+    FApng(const FApng&) = delete;
+    FApng& operator=(const FApng&) = delete;
+
+    bool Valid() const
+    { return file != nullptr; }
+    unsigned Frames() const
+    { return frames; }
+
+    // Add next frame, 32bit the same size as the first frame.
+    bool Add(const FImage& imgP32);
+
+    // Write the pending frame and the frame count, false if any write failed.
+    bool Close();
+
+private:
+    struct FrameCtl {                   // fcTL fields
+        unsigned sequence;
+        unsigned width, height;
+        unsigned x, y;                  // From the top left
+        unsigned delay;                 // Milliseconds
+        BYTE blendOp;
+    };
+
+    FILE* file;
+    const unsigned delayMs;
+    unsigned frames = 0;                // fcTL written or pending
+    unsigned sequence = 0;              // Next fcTL or fdAT sequence number
+    bool okay = true;
+    long actlPos = 0;                   // acTL chunk, frame count written by Close
+    FImageRef canvasRef;                // Previous frame
+    FrameCtl pending {};                // Last frame, written when the next frame differs
+    std::vector<BYTE> pendingData;      // Its IDAT or fdAT chunks
+
+    bool writePending();
+    bool write(const std::vector<BYTE>& data);
+};
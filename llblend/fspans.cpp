@@ -0,0 +1,78 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FSpans.cpp
+//  Desc: Run list of non transparent pixel spans per scanline of 8bit image.
+//
+//  FSpans created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "fspans.hpp"
+#include "fimage.hpp"
+
+#include <stdint.h>
+#include <string.h>
+
+// -------------------------------------------------------------------------------------------------
+// Clear runs are skipped 8 bytes at a time.
+FSpans::FSpans(const FImage& imgI8, BYTE _clearIdx)
+    : clearIdx(_clearIdx), width(imgI8.GetWidth()), height(imgI8.GetHeight()), pixels(0) {
+    const uint64_t clearWord = 0x0101010101010101ULL * clearIdx;
+    rowStart.resize(height + 1);
+
+    for (unsigned y = 0; y < height; y++) {
+        rowStart[y] = (unsigned)spans.size();
+        const BYTE* row = imgI8.ReadScanLine(y);
+        unsigned x = 0;
+        while (x < width) {
+            for (; x + 8 <= width; x += 8) {
+                uint64_t word;
+                memcpy(&word, row + x, sizeof(word));
+                if (word != clearWord)
+                    break;
+            }
+            while (x < width && row[x] == clearIdx) {
+                x++;
+            }
+            if (x == width)
+                break;
+
+            FSpan span;
+            span.x = x;
+            while (x < width && row[x] != clearIdx) {
+                x++;
+            }
+            span.len = x - span.x;
+            pixels += span.len;
+            spans.push_back(span);
+        }
+    }
+    rowStart[height] = (unsigned)spans.size();
+}
@@ -0,0 +1,83 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FSpans.hpp
+//  Desc: Run list of non transparent pixel spans per scanline of 8bit image.
+//
+//  FSpans created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#pragma once
+
+#include "freeimage/FreeImage.h"
+
+#include <memory>
+#include <vector>
+
+// Forward ref
+class FImage;
+
+// Run of pixels which are not the clear index, [x, x+len)
+struct FSpan {
+    unsigned x;
+    unsigned len;
+};
+
+// ---------------------------------------------------------------------------
+// Run list of pixels which are not the clear (transparent) index, per scanline.
+// Built once per 8bit frame so index kernels jump over transparent runs
+// instead of testing every byte. Spans in a row are sorted and do not touch.
+class FSpans {
+public:
+    const BYTE clearIdx;
+    const unsigned width;
+    const unsigned height;
+
+    FSpans(const FImage& imgI8, BYTE clearIdx = 0);
+
+    const FSpan* begin(unsigned y) const
+    { return spans.data() + rowStart[y]; }
+    const FSpan* end(unsigned y) const
+    { return spans.data() + rowStart[y + 1]; }
+    bool RowClear(unsigned y) const
+    { return rowStart[y] == rowStart[y + 1]; }
+
+    size_t SpanCount() const
+    { return spans.size(); }
+    size_t PixelCount() const   // Pixels not clear
+    { return pixels; }
+
+private:
+    std::vector<FSpan> spans;
+    std::vector<unsigned> rowStart;
+    size_t pixels;
+};
+
+typedef std::shared_ptr<FSpans> FSpansRef;
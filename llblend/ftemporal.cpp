@@ -0,0 +1,176 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FTemporal.cpp
+//  Desc: Temporal blend modes, one policy class per mode compiled into its own row loop.
+//
+//  FTemporal created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#include "ftemporal.hpp"
+#include "blendfutil.hpp"
+#include "fkernel.hpp"
+#include "fthreadpool.hpp"
+
+#include <string.h>
+
+// -------------------------------------------------------------------------------------------------
+// Blend frame into the state and output, one policy update and output per pixel.
+template <class Policy>
+void FTemporalT<Policy>::blendRow(const FColor* lut, const BYTE* idx, State* state, FColor* out, unsigned count) {
+    for (unsigned x = 0; x < count; x++) {
+        policy.update(state[x], lut, idx[x]);
+        out[x] = policy.output(state[x], lut, idx[x]);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+template <class Policy>
+void FTemporalT<Policy>::updateRow(const FColor* lut, const BYTE* idx, State* state, unsigned count) {
+    for (unsigned x = 0; x < count; x++) {
+        policy.update(state[x], lut, idx[x]);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// Maximum state is an index row, so it uses the vector max and palette expand kernels.
+template <>
+void FTemporalT<FTemporalMax>::blendRow(const FColor* lut, const BYTE* idx, BYTE* state, FColor* out, unsigned count) {
+    FKernel::maxRow(idx, state, count);
+    FKernel::expandBlendRow(lut, state, nullptr, out, count);
+}
+
+template <>
+void FTemporalT<FTemporalMax>::updateRow(const FColor* lut, const BYTE* idx, BYTE* state, unsigned count) {
+    FKernel::maxRow(idx, state, count);
+}
+
+// -------------------------------------------------------------------------------------------------
+// Blend one frame into the state, output is made when outP32 is not null.
+template <class Policy>
+void FTemporalT<Policy>::frame(const FColor* frameLut, const FImage& frameI8, FImage* outP32) {
+    policy.nextFrame();
+    std::copy(frameLut, frameLut + 256, lastLut);
+
+    unsigned frameHeight = frameI8.GetHeight();
+    unsigned frameWidth = frameI8.GetWidth();
+    const FSpans* frameSpans = nullptr;
+    if (outP32 != nullptr) {
+        frameHeight = std::min(frameHeight, outP32->GetHeight());
+        frameWidth = std::min(frameWidth, outP32->GetWidth());
+        frameSpans = BlendFUtil::useSpans ? &frameI8.Spans() : nullptr;
+    }
+    unsigned blendHeight = std::min(frameHeight, height);
+    unsigned blendWidth = std::min(frameWidth, width);
+
+    FThreadPool::get().forBands(frameHeight, frameWidth * 4, [&](unsigned y0, unsigned y1) {
+        for (unsigned y = y0; y < y1; y++) {
+            const BYTE* idx = frameI8.ReadScanLine(y);
+            if (outP32 == nullptr) {
+                if (y < blendHeight) {
+                    updateRow(frameLut, idx, stateRow(y), blendWidth);
+                }
+                continue;
+            }
+            FColor* out = (FColor*)outP32->ScanLine(y);
+            if (y < blendHeight) {
+                blendRow(frameLut, idx, stateRow(y), out, blendWidth);
+                BlendFUtil::ExpandI8Row(frameLut, frameI8, frameSpans, y, out, blendWidth, frameWidth);
+            } else {
+                BlendFUtil::ExpandI8Row(frameLut, frameI8, frameSpans, y, out, 0, frameWidth);
+            }
+        }
+    });
+}
+
+// -------------------------------------------------------------------------------------------------
+// Blend frames into the state without making output, frameLuts has 256 entries per frame.
+template <class Policy>
+void FTemporalT<Policy>::UpdateFrames(const std::vector<const FImage*>& framesI8, const std::vector<FColor>& frameLuts) {
+    for (size_t idx = 0; idx < framesI8.size(); idx++) {
+        frame(&frameLuts[idx * 256], *framesI8[idx], nullptr);
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+template <class Policy>
+FImage* FTemporalT<Policy>::ToImage() const {
+    FImage* imgPtr = FImage::Allocate(width, height, 32);
+    for (unsigned y = 0; y < height; y++) {
+        FColor* row = (FColor*)imgPtr->ScanLine(y);
+        const State* state = &states[(size_t)y * width];
+        for (unsigned x = 0; x < width; x++) {
+            row[x] = policy.color(state[x], lastLut);
+        }
+    }
+    return imgPtr;
+}
+
+// -------------------------------------------------------------------------------------------------
+// True if the per pixel states are the same, states are plain data.
+template <class Policy>
+bool FTemporalT<Policy>::SameHidden(const FOverlay& other) const {
+    const FTemporalT* otherPtr = dynamic_cast<const FTemporalT*>(&other);
+    return otherPtr != nullptr && states.size() == otherPtr->states.size()
+        && memcmp(states.data(), otherPtr->states.data(), states.size() * sizeof(State)) == 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+FOverlay* FTemporal::Create(const BlendCfg& cfg, unsigned width, unsigned height) {
+    switch (cfg.temporalMode) {
+    case TEMPORAL_MAX:
+        return new FTemporalT<FTemporalMax>(width, height, FTemporalMax());
+    case TEMPORAL_MEAN:
+        return new FTemporalT<FTemporalMean>(width, height, FTemporalMean());
+    case TEMPORAL_LAST:
+        return new FTemporalT<FTemporalLast>(width, height, FTemporalLast());
+    case TEMPORAL_HOLD:
+        return new FTemporalT<FTemporalHold>(width, height, FTemporalHold(cfg.holdIndex, cfg.holdFrames));
+    case TEMPORAL_OVER:
+        break;
+    }
+    return FOverlay::Create(cfg.overlayMode, width, height, cfg.decay);
+}
+
+// -------------------------------------------------------------------------------------------------
+unsigned FTemporal::DecayFrames(const BlendCfg& cfg) {
+    switch (cfg.temporalMode) {
+    case TEMPORAL_MAX:
+    case TEMPORAL_MEAN:
+    case TEMPORAL_LAST:
+        return FOverlay::NEVER;
+    case TEMPORAL_HOLD:
+        return cfg.holdFrames + 1;
+    case TEMPORAL_OVER:
+        break;
+    }
+    return (cfg.overlayMode == OVERLAY_NONE) ? 0
+        : (cfg.overlayMode == OVERLAY_A16) ? FOverlayA16::DecayFrames(cfg.decay)
+        : FOverlay::DecayFrames(cfg.decay);
+}
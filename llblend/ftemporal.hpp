@@ -0,0 +1,200 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FTemporal.hpp
+//  Desc: Temporal blend modes, one policy class per mode compiled into its own row loop.
+//
+//  FTemporal created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+
+#pragma once
+
+#include "fimage.hpp"
+#include "blendcfg.hpp"
+#include "foverlay.hpp"
+
+#include <algorithm>
+#include <vector>
+#include <stdint.h>
+
+// ---------------------------------------------------------------------------
+// Temporal blend policies. Each policy keeps a State per pixel, starting zero filled:
+//   nextFrame()                   - per frame constants, called before the frame's rows
+//   update(state, lut, idx)       - blend frame pixel into the state
+//   output(state, lut, idx)       - output pixel, after update
+//   color(state, lut)             - accumulated color for ToImage
+// Over with decay is FOverlay (-overlay picks its layout), these are the other modes.
+
+// Maximum pixel index so far, same index order as MaximumI8.
+struct FTemporalMax {
+    typedef BYTE State;
+
+    void nextFrame() { }
+    void update(State& state, const FColor* lut, BYTE idx) const {
+        state = std::max(state, idx);
+    }
+    FColor output(const State& state, const FColor* lut, BYTE idx) const {
+        return lut[state];
+    }
+    FColor color(const State& state, const FColor* lut) const {
+        return lut[state];
+    }
+};
+
+// Mean color of all frames so far, rounded. Divide is a multiply by 2^40 / frames,
+// exact while frames < 65536.
+struct FTemporalMean {
+    struct State {
+        unsigned blue = 0;
+        unsigned green = 0;
+        unsigned red = 0;
+        unsigned alpha = 0;
+    };
+    unsigned frames = 0;
+    uint64_t recip = 0;
+
+    void nextFrame() {
+        frames++;
+        recip = (frames < 65536) ? ((uint64_t)1 << 40) / frames + 1 : 0;
+    }
+    BYTE mean(unsigned sum) const {
+        uint64_t round = sum + frames / 2;
+        return (BYTE)((recip != 0) ? (round * recip) >> 40 : round / frames);
+    }
+    void update(State& state, const FColor* lut, BYTE idx) const {
+        const FColor& in = lut[idx];
+        state.blue += in.rgbBlue;
+        state.green += in.rgbGreen;
+        state.red += in.rgbRed;
+        state.alpha += in.rgbReserved;
+    }
+    FColor output(const State& state, const FColor* lut, BYTE idx) const {
+        return color(state, lut);
+    }
+    FColor color(const State& state, const FColor* lut) const {
+        return (frames == 0) ? FColor()
+            : FColor(mean(state.red), mean(state.green), mean(state.blue), mean(state.alpha));
+    }
+};
+
+// Last frame color with alpha, transparent pixels keep the previous color.
+struct FTemporalLast {
+    typedef FColor State;
+
+    void nextFrame() { }
+    void update(State& state, const FColor* lut, BYTE idx) const {
+        if (lut[idx].rgbReserved != 0)
+            state = lut[idx];
+    }
+    FColor output(const State& state, const FColor* lut, BYTE idx) const {
+        return (state.rgbReserved != 0) ? state : lut[idx];
+    }
+    FColor color(const State& state, const FColor* lut) const {
+        return state;
+    }
+};
+
+// Last color at or above holdIndex is held for holdFrames frames after the frame which set it.
+struct FTemporalHold {
+    struct State {
+        FColor color;
+        unsigned remain = 0;            // Frames left to hold + 1, 0 not held
+    };
+    unsigned holdIndex;
+    unsigned holdFrames;
+
+    FTemporalHold(unsigned _holdIndex, unsigned _holdFrames)
+        : holdIndex(_holdIndex), holdFrames(_holdFrames)
+    { }
+    void nextFrame() { }
+    void update(State& state, const FColor* lut, BYTE idx) const {
+        if (idx >= holdIndex) {
+            state.color = lut[idx];
+            state.remain = holdFrames + 1;
+        } else if (state.remain != 0) {
+            state.remain--;
+        }
+    }
+    FColor output(const State& state, const FColor* lut, BYTE idx) const {
+        return (state.remain != 0) ? state.color : lut[idx];
+    }
+    FColor color(const State& state, const FColor* lut) const {
+        return (state.remain != 0) ? state.color : FPalette::TRANSPARENT;
+    }
+};
+
+// ---------------------------------------------------------------------------
+// Temporal blend engine, runs one policy over every frame. The policy calls are inlined
+// into the row loops, there is no per pixel dispatch. Composite blends the frame into
+// the state and makes the output in one pass, Update does nothing.
+// Frame pixels outside the state are expanded, state outside the frame is not changed.
+template <class Policy>
+class FTemporalT : public FOverlay {
+    typedef typename Policy::State State;
+
+    Policy policy;
+    std::vector<State> states;
+    FColor lastLut[256];                // Frame colors of the last frame, for ToImage
+
+    State* stateRow(unsigned y) {
+        return &states[(size_t)y * width];
+    }
+    void blendRow(const FColor* lut, const BYTE* idx, State* state, FColor* out, unsigned count);
+    void updateRow(const FColor* lut, const BYTE* idx, State* state, unsigned count);
+    void frame(const FColor* frameLut, const FImage& frameI8, FImage* outP32);
+
+public:
+    FTemporalT(unsigned width, unsigned height, const Policy& _policy)
+        : FOverlay(width, height, 1.0f), policy(_policy), states((size_t)width * height)
+    { }
+
+    void Composite(const FColor* frameLut, const FImage& frameI8, FImage& outP32) {
+        frame(frameLut, frameI8, &outP32);
+    }
+    void Update(const FColor* overlayLut, const FImage& frameI8) { }
+    void UpdateFrames(const std::vector<const FImage*>& framesI8, const std::vector<FColor>& frameLuts);
+    FImage* ToImage() const;
+    FOverlay* Clone() const {
+        return new FTemporalT(*this);
+    }
+    bool SameHidden(const FOverlay& other) const;
+};
+
+// ---------------------------------------------------------------------------
+class FTemporal {
+public:
+    // Blend state for cfg temporalMode, over uses the cfg overlayMode (null if none).
+    static FOverlay* Create(const BlendCfg& cfg, unsigned width, unsigned height);
+
+    // Frames until a frame no longer changes the output, NEVER if it always can.
+    static unsigned DecayFrames(const BlendCfg& cfg);
+};
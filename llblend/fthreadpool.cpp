@@ -0,0 +1,165 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FThreadPool.cpp
+//  Desc: Shared worker thread pool for row band parallel pixel kernels.
+//
+//  FThreadPool created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "fthreadpool.hpp"
+
+#include <algorithm>
+
+std::atomic<unsigned> FThreadPool::threadCnt(0);
+std::atomic<bool> FThreadPool::started(false);
+std::unique_ptr<FThreadPool> FThreadPool::pool;
+static std::once_flag poolOnce;
+
+static thread_local bool inPoolJob = false;
+
+// Minimum band, smaller bands cost more to schedule than they save.
+static const unsigned MIN_BAND_BYTES = 16 * 1024;
+static const unsigned BANDS_PER_THREAD = 4;
+
+// -------------------------------------------------------------------------------------------------
+// Created once by the first caller, which can be any thread (ex: encode threads).
+FThreadPool& FThreadPool::get() {
+    std::call_once(poolOnce, [] {
+        started = true;
+        pool.reset(new FThreadPool(getThreads()));
+    });
+    return *pool;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Only before first use, the running pool is never replaced.
+bool FThreadPool::setThreads(unsigned _threadCnt) {
+    if (started)
+        return false;
+    threadCnt = _threadCnt;
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+unsigned FThreadPool::getThreads() {
+    unsigned cnt = threadCnt;
+    return (cnt != 0) ? cnt : std::max(1u, std::thread::hardware_concurrency());
+}
+
+// -------------------------------------------------------------------------------------------------
+FThreadPool::FThreadPool(unsigned threadCnt)
+    : taskFn(nullptr), taskCnt(0), nextTask(0), busyCnt(0), generation(0), quit(false) {
+    for (unsigned idx = 1; idx < threadCnt; idx++) {
+        workers.push_back(std::thread(&FThreadPool::workerLoop, this));
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+FThreadPool::~FThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wakeCv.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+void FThreadPool::workerLoop() {
+    unsigned seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeCv.wait(lock, [&] { return quit || generation != seen; });
+            if (quit)
+                return;
+            seen = generation;
+        }
+
+        runTasks();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busyCnt == 0) {
+            doneCv.notify_one();
+        }
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+void FThreadPool::runTasks() {
+    inPoolJob = true;
+    for (unsigned idx = nextTask++; idx < taskCnt; idx = nextTask++) {
+        (*taskFn)(idx);
+    }
+    inPoolJob = false;
+}
+
+// -------------------------------------------------------------------------------------------------
+void FThreadPool::forEach(unsigned count, const TaskFn& fn) {
+    std::unique_lock<std::mutex> jobLock(jobMutex, std::try_to_lock);
+    if (count <= 1 || workers.empty() || inPoolJob || ! jobLock.owns_lock()) {
+        for (unsigned idx = 0; idx < count; idx++) {
+            fn(idx);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        taskFn = &fn;
+        taskCnt = count;
+        nextTask = 0;
+        busyCnt = (unsigned)workers.size();
+        generation++;
+    }
+    wakeCv.notify_all();
+
+    runTasks();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCv.wait(lock, [&] { return busyCnt == 0; });
+    taskFn = nullptr;
+}
+
+// -------------------------------------------------------------------------------------------------
+void FThreadPool::forBands(unsigned height, unsigned bytesPerRow, const BandFn& fn) {
+    unsigned threads = (unsigned)workers.size() + 1;
+    unsigned minRows = std::max(1u, MIN_BAND_BYTES / std::max(1u, bytesPerRow));
+    unsigned bandRows = std::max(minRows, (height + threads * BANDS_PER_THREAD - 1) / (threads * BANDS_PER_THREAD));
+    unsigned bandCnt = (height + bandRows - 1) / bandRows;
+
+    forEach(bandCnt, [&](unsigned band) {
+        unsigned y0 = band * bandRows;
+        fn(y0, std::min(y0 + bandRows, height));
+    });
+}
@@ -0,0 +1,88 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FThreadPool.hpp
+//  Desc: Shared worker thread pool for row band parallel pixel kernels.
+//
+//  FThreadPool created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Shared pool of worker threads. The calling thread joins in on every job.
+// Calls made while the pool is busy, or from inside a job, run on the calling thread,
+// so kernels can nest (ex: per frame workers calling banded row kernels).
+class FThreadPool {
+public:
+    typedef std::function<void(unsigned idx)> TaskFn;
+    typedef std::function<void(unsigned y0, unsigned y1)> BandFn;
+
+    static FThreadPool& get();
+    static bool setThreads(unsigned threadCnt);     // 0 = cpu core count, false once the pool is used
+    static unsigned getThreads();
+
+    // Run fn(idx) for idx in [0, count), returns when all done.
+    void forEach(unsigned count, const TaskFn& fn);
+
+    // Run fn(y0, y1) over horizontal row bands of [0, height), band rows adapt to bytesPerRow.
+    void forBands(unsigned height, unsigned bytesPerRow, const BandFn& fn);
+
+    ~FThreadPool();
+
+private:
+    FThreadPool(unsigned threadCnt);
+    void workerLoop();
+    void runTasks();
+
+    std::vector<std::thread> workers;
+    std::mutex jobMutex;                // One job at a time
+    std::mutex mutex;
+    std::condition_variable wakeCv;
+    std::condition_variable doneCv;
+    const TaskFn* taskFn;
+    unsigned taskCnt;
+    std::atomic<unsigned> nextTask;
+    unsigned busyCnt;
+    unsigned generation;
+    bool quit;
+
+    static std::atomic<unsigned> threadCnt;
+    static std::atomic<bool> started;   // Pool created, thread count is fixed
+    static std::unique_ptr<FThreadPool> pool;
+};
@@ -0,0 +1,199 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FWindow.cpp
+//  Desc: Sliding window maximum or mean of 8bit index frames.
+//
+//  FWindow created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+
+#include "fwindow.hpp"
+#include "fthreadpool.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdint.h>
+#include <string.h>
+
+// -------------------------------------------------------------------------------------------------
+FWindow::FWindow(unsigned _frames, Stat _stat)
+    : frames(std::max(1u, std::min(_frames, MAX_FRAMES))), stat(_stat),
+      width(0), height(0), ring(frames), next(0), count(0)
+{ }
+
+// -------------------------------------------------------------------------------------------------
+// Blend non transparent pixels of the frame entering the window into the statistic.
+void FWindow::enterRow(const FImage& frameI8, unsigned y) {
+    const BYTE* idx = frameI8.ReadScanLine(y);
+    const FSpans& spans = frameI8.Spans();
+    size_t rowOff = (size_t)y * width;
+
+    for (const FSpan* span = spans.begin(y); span != spans.end(y); span++) {
+        unsigned x1 = std::min(span->x + span->len, width);
+        if (stat == MEAN) {
+            for (unsigned x = span->x; x < x1; x++) {
+                sums[rowOff + x] += idx[x];
+            }
+            continue;
+        }
+        for (unsigned x = span->x; x < x1; x++) {
+            BYTE level = idx[x];
+            size_t pix = rowOff + x;
+            if (level < LEVELS) {
+                counts[pix * LEVELS + level]++;
+            } else {
+                highCounts[pix]++;
+            }
+            maxes[pix] = std::max(maxes[pix], level);
+        }
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// Remove non transparent pixels of the frame leaving the window from the statistic.
+void FWindow::leaveRow(const FImage& frameI8, unsigned y) {
+    const BYTE* idx = frameI8.ReadScanLine(y);
+    const FSpans& spans = frameI8.Spans();
+    size_t rowOff = (size_t)y * width;
+
+    for (const FSpan* span = spans.begin(y); span != spans.end(y); span++) {
+        unsigned x1 = std::min(span->x + span->len, width);
+        if (stat == MEAN) {
+            for (unsigned x = span->x; x < x1; x++) {
+                sums[rowOff + x] -= idx[x];
+            }
+            continue;
+        }
+        for (unsigned x = span->x; x < x1; x++) {
+            BYTE level = idx[x];
+            size_t pix = rowOff + x;
+            bool last;
+            if (level < LEVELS) {
+                last = (--counts[pix * LEVELS + level] == 0);
+            } else {
+                highCounts[pix]--;
+                last = true;    // Not counted per level, search
+            }
+            if (last && level == maxes[pix]) {
+                maxes[pix] = findMax(x, y, level);
+            }
+        }
+    }
+}
+
+// -------------------------------------------------------------------------------------------------
+// Maximum of pixel after its maximum level left, searched down from level.
+// Called while the leaving frame is still in the ring at next.
+BYTE FWindow::findMax(unsigned x, unsigned y, BYTE level) const {
+    size_t pix = (size_t)y * width + x;
+    if (highCounts[pix] != 0) {
+        BYTE best = 0;
+        for (unsigned slot = 0; slot < frames; slot++) {
+            if (slot != next && ring[slot] != nullptr) {
+                best = std::max(best, ring[slot]->ReadScanLine(y)[x]);
+            }
+        }
+        return best;
+    }
+
+    const BYTE* levels = &counts[pix * LEVELS];
+    for (unsigned down = std::min((unsigned)level, LEVELS - 1); down > 0; down--) {
+        if (levels[down] != 0)
+            return (BYTE)down;
+    }
+    return 0;
+}
+
+// -------------------------------------------------------------------------------------------------
+bool FWindow::Push(FImageRef& frameI8Ref) {
+    const FImage& frameI8 = *frameI8Ref;
+    if (frameI8.GetBitsPerPixel() != 8) {
+        std::cerr << "Window - Frame not 8bit" << std::endl;
+        return false;
+    }
+    if (width == 0) {
+        width = frameI8.GetWidth();
+        height = frameI8.GetHeight();
+        size_t pixels = (size_t)width * height;
+        if (stat == MEAN) {
+            sums.assign(pixels, 0);
+        } else {
+            maxes.assign(pixels, 0);
+            counts.assign(pixels * LEVELS, 0);
+            highCounts.assign(pixels, 0);
+        }
+    } else if (frameI8.GetWidth() != width || frameI8.GetHeight() != height) {
+        std::cerr << "Window - Frame size " << frameI8.GetWidth() << "x" << frameI8.GetHeight()
+            << " not " << width << "x" << height << std::endl;
+        return false;
+    }
+
+    const FImage* leaving = ring[next].get();
+    frameI8.Spans();    // Build before bands share it
+
+    FThreadPool::get().forBands(height, width, [&](unsigned y0, unsigned y1) {
+        for (unsigned y = y0; y < y1; y++) {
+            if (leaving != nullptr) {
+                leaveRow(*leaving, y);
+            }
+            enterRow(frameI8, y);
+        }
+    });
+
+    ring[next].swap(frameI8Ref);
+    next = (next + 1) % frames;
+    count = std::min(count + 1, frames);
+    return true;
+}
+
+// -------------------------------------------------------------------------------------------------
+// Mean is rounded, divide is a multiply by 2^24 / count which is exact for sums of up to 255 frames.
+void FWindow::Output(FImage& outI8) const {
+    unsigned outHeight = std::min(height, outI8.GetHeight());
+    unsigned outWidth = std::min(width, outI8.GetWidth());
+    unsigned recip = (count != 0) ? (1u << 24) / count + 1 : 0;
+    unsigned half = count / 2;
+    outI8.ClearSpans();
+
+    FThreadPool::get().forBands(outHeight, outWidth, [&](unsigned y0, unsigned y1) {
+        for (unsigned y = y0; y < y1; y++) {
+            BYTE* out = outI8.ScanLine(y);
+            size_t rowOff = (size_t)y * width;
+            if (stat == MAX) {
+                memcpy(out, &maxes[rowOff], outWidth);
+                continue;
+            }
+            const WORD* sum = &sums[rowOff];
+            for (unsigned x = 0; x < outWidth; x++) {
+                out[x] = (BYTE)(((uint64_t)(sum[x] + half) * recip) >> 24);
+            }
+        }
+    });
+}
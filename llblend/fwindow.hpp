@@ -0,0 +1,90 @@
+//-------------------------------------------------------------------------------------------------
+//  File: FWindow.hpp
+//  Desc: Sliding window maximum or mean of 8bit index frames.
+//
+//  FWindow created by Dennis Lang on 10/16/26.
+//  Copyright © 2026 Dennis Lang. All rights reserved.
+//
+//-------------------------------------------------------------------------------------------------
+//
+// Author: Dennis Lang - 2021
+// https://landenlabs.com
+//
+// This file is part of llblendF project.
+//
+// ----- License ----
+//
+// Copyright (c) 2026 Dennis Lang
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+// FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+// COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+// IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+// CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+#pragma once
+
+
+#pragma once
+
+#include "fimage.hpp"
+
+#include <vector>
+
+// ---------------------------------------------------------------------------
+// Per pixel maximum or mean index over the last N 8bit frames, N <= MAX_FRAMES.
+// Each Push adds a frame and drops the oldest, only the non transparent spans of
+// those two frames are visited (index 0 adds nothing to either statistic).
+//   Mean - running sum of indices per pixel.
+//   Max  - per pixel count of each index level below LEVELS (nowrad palette has 32)
+//          and the current maximum. When the last pixel at the maximum leaves, the
+//          counts are searched down for the new maximum. Indices at or above LEVELS
+//          are counted together and the window frames are searched instead (rare).
+class FWindow {
+public:
+    enum Stat { MAX, MEAN };
+    static constexpr unsigned LEVELS = 32;
+    static constexpr unsigned MAX_FRAMES = 255;
+
+    const unsigned frames;
+    const Stat stat;
+
+    FWindow(unsigned frames, Stat stat);
+
+    // Add frame to the window, returns false if it is not 8bit or not the size of the first frame.
+    // Frame is kept until it leaves the window, the frame which left is returned in frameI8Ref.
+    bool Push(FImageRef& frameI8Ref);
+
+    // Window statistic as pixel indices into outI8, same size as the frames.
+    void Output(FImage& outI8) const;
+
+    unsigned Count() const
+    { return count; }
+
+private:
+    unsigned width;
+    unsigned height;
+    std::vector<FImageRef> ring;        // Window frames, next is the oldest once full
+    unsigned next;
+    unsigned count;
+
+    std::vector<WORD> sums;             // Mean, sum of window indices
+    std::vector<BYTE> maxes;            // Max, current maximum index
+    std::vector<BYTE> counts;           // Max, [pixel][level] window frames at level, level 0 not used
+    std::vector<BYTE> highCounts;       // Max, window frames at LEVELS or above
+
+    void enterRow(const FImage& frameI8, unsigned y);
+    void leaveRow(const FImage& frameI8, unsigned y);
+    BYTE findMax(unsigned x, unsigned y, BYTE level) const;
+};
@@ -60,6 +60,11 @@
 #include "ll_stdhdr.hpp"
 #include "split.hpp"
 #include "blendcfg.hpp"
+#include "fkernel.hpp"
+#include "fthreadpool.hpp"
+#include "fmapfile.hpp"
+#include "fpng.hpp"
+#include "fpack.hpp"
 
 // #include <Magick++.h>
 // using namespace Magick;
@@ -76,6 +81,7 @@ uint patternErrCnt = 0;
 #ifdef HAVE_WIN
     #include <assert.h>
     #define strncasecmp _strnicmp
+    #define strcasecmp _stricmp
     #if !defined(S_ISREG) && defined(S_IFMT) && defined(S_IFREG)
         #define S_ISREG(m) (((m)&S_IFMT) == S_IFREG)
     #endif
@@ -246,7 +252,58 @@ void showHelp(char* name) {
                "\n"
                "   -includefile=<filePattern>\n"
                "   -excludefile=<filePattern>\n"
+               "   -decay=<0..1>                   ; Overlay alpha decay per frame, default 0.99\n"
+               "   -isa=scalar|sse2|avx2|avx512    ; Limit blend kernel cpu instructions\n"
+               "   -overlay=none|p32|lazy|tiled|premul|a16|planar|index\n"
+               "                                   ; Accumulate decaying overlay, lazy only writes changed pixels,\n"
+               "                                   ;   tiled skips empty 64x64 tiles, premul uses premultiplied alpha,\n"
+               "                                   ;   a16 keeps 16bit alpha for long decays,\n"
+               "                                   ;   planar decays a separate alpha plane,\n"
+               "                                   ;   index keeps an overlay color index and age per pixel,\n"
+               "                                   ;   newest overlay color replaces older ones\n"
+               "   -mode=over|max|mean|last|hold   ; Blend over time, over is the decaying overlay (default),\n"
+               "                                   ;   max index, mean color, last non transparent color,\n"
+               "                                   ;   hold colors at or above an index for some frames\n"
+               "   -hold=<index>,<frames>          ; Hold mode threshold index and frames, default 6,12\n"
+               "   -gamma=srgb|linear              ; Blend overlay over frames in sRGB (default) or linear light\n"
+               "   -layer=[dst-]<op>:<file>        ; Composite image onto each output frame, repeat for more,\n"
+               "                                   ;   layer OP frame, dst- is frame OP layer, op is over, in, out,\n"
+               "                                   ;   atop, xor, plus, multiply or screen\n"
+               "                                   ;   ex: -layer=dst-over:basemap.png -layer=over:borders.png\n"
+               "   -class=<name>[:<first>-<last>][@<decay>]\n"
+               "                                   ; Overlay per precipitation class, all classes from one\n"
+               "                                   ;   decode of each frame, repeat for more, saved as <name>_<file>,\n"
+               "                                   ;   overlays keep the frame colors, rain, freeze, mixed and snow\n"
+               "                                   ;   default to their nowrad range, all adds those four\n"
+               "                                   ;   ex: -class=all  -class=snow@0.95 -class=hail:40-44\n"
+               "   -threads=<count>                ; Row band threads per frame, default cpu cores\n"
+               "   -decode=fast|freeimage          ; 8bit palette png frames decoded by the fast path (default)\n"
+               "                                   ;   or all images by FreeImage\n"
+               "   -png=fast|default|small|freeimage|<level>[,<filter>]\n"
+               "                                   ; Png output encoder, row blocks deflated in parallel,\n"
+               "                                   ;   fast is level 1 sub filter, default level 6 adaptive filter,\n"
+               "                                   ;   small level 9, freeimage saves with FreeImage at the level,\n"
+               "                                   ;   filter none, sub, up, avg, paeth or adaptive  ex: -png=3,up\n"
+               "   -apng=<file>[,<delayMs>]        ; Save blend outputs as one animated png, default 100ms per frame,\n"
+               "                                   ;   each frame only holds the box of pixels changed from the\n"
+               "                                   ;   previous output, not with -final, -chunks, -class or -window\n"
+               "                                   ;   ex: -apng=loop.png,250\n"
+               "   -openfiles=<count>              ; Input files open at once while mapped, default 64\n"
+               "   -pack=<file>.llpack[,raw|lz4]   ; Pack frames into one file, 8bit planes lz4 (default) or raw,\n"
+               "                                   ;   pack files given as input replay their frames from the\n"
+               "                                   ;   mapped file, raw planes without a copy\n"
+               "                                   ;   ex: -pack=day.llpack *.png   then  llblend day.llpack\n"
+               "   -chunks=<count>                 ; Blend frame chunks in parallel, needs decay < 1,\n"
+               "                                   ;   each chunk first replays 2 overlay decay lifetimes of frames\n"
+               "                                   ;   (310 at decay 0.99), only pays off when chunks are much longer,\n"
+               "                                   ;   shorter chunks blend in series\n"
+               "   -final=<batch>                  ; Only save last frame and overlay, overlay updated by\n"
+               "                                   ;   batches of frames while rows are in cache, ex: -final=16\n"
                "   -verbose \n"
+               "   -bench                          ; Time index kernels with and without transparent span skip\n"
+               "   -maximum                        ; Maximum pixel index over all frames, saved to maximum.png\n"
+               "   -window=<frames>                ; Maximum (or -mode=mean) pixel index over the last frames,\n"
+               "                                   ;   saved per frame, frames <= 255\n"
                "\n"
                " Example: \n"
                "   llblend foo.png \n"
@@ -295,6 +352,11 @@ int main(int argc, char* argv[]) {
     BlendCfg blendCfg;
     CmdBlendF doBlendF(blendCfg);
     CmdDumpF doDumpF(blendCfg);
+    CmdBenchF doBenchF(blendCfg);
+    CmdMaximumF doMaximumF(blendCfg);
+    CmdWindowF doWindowF(blendCfg);
+    CmdClassF doClassF(blendCfg);
+    CmdPackF doPackF;
     Command* commandPtr = &doBlendF;
 
 
@@ -333,6 +395,22 @@ int main(int argc, char* argv[]) {
                     case 'p':
                         if (ValidOption("postDivider", cmd + 1, false)) {
                             commandPtr->postDivider = ConvertSpecialChar(value);
+                        } else if (ValidOption("png", cmd + 1, false)) {
+                            // png=fast|default|small|freeimage|<level>[,<filter>]
+                            if (! FPng::setEncode(value)) {
+                                optionErrCnt++;
+                            }
+                        } else if (ValidOption("pack", cmd + 1, false)) {
+                            // pack=<file>[,raw|lz4]
+                            Split packArgs(value, ",");
+                            doPackF.outName = packArgs.empty() ? "" : packArgs[0];
+                            doPackF.lz4 = (packArgs.size() < 2 || strcasecmp(packArgs[1].c_str(), "lz4") == 0);
+                            if (doPackF.outName.empty() || ! FPack::IsPack(doPackF.outName)
+                                || (packArgs.size() > 1 && ! doPackF.lz4 && strcasecmp(packArgs[1].c_str(), "raw") != 0)) {
+                                std::cerr << "Pack needs -pack=<file>" << FPack::EXTN << "[,raw|lz4]" << std::endl;
+                                optionErrCnt++;
+                            }
+                            commandPtr = &doPackF;
                         } else if (ValidOption("preDivider", cmd + 1)) {
                             commandPtr->preDivider = ConvertSpecialChar(value);
                         }
@@ -343,10 +421,19 @@ int main(int argc, char* argv[]) {
                         }
                         break;
                     case 'i':
-                        if (ValidOption("includefile", cmd + 1)) {
+                        if (ValidOption("includefile", cmd + 1, false)) {
                             // includeFile=<pat>
                             ReplaceAll(value, "*", ".*");
                             commandPtr->includeFilePatList.push_back(getRegEx(value));
+                        } else if (ValidOption("isa", cmd + 1)) {
+                            // isa=scalar|sse2|avx2|avx512
+                            FKernel::Isa maxIsa;
+                            if (FKernel::parseIsa(value, maxIsa)) {
+                                FKernel::select(maxIsa);
+                            } else {
+                                std::cerr << "Unknown isa " << value << std::endl;
+                                optionErrCnt++;
+                            }
                         }
                         break;
                     case 'e':  // excludeFile=<pat>
@@ -356,10 +443,113 @@ int main(int argc, char* argv[]) {
                         }
                         break;
 
+                    case 'd':  // decay=<0..1>
+                        if (ValidOption("decay", cmd + 1, false)) {
+                            blendCfg.setDecay((float)strtod(value, nullptr));
+                        } else if (ValidOption("decode", cmd + 1)) {
+                            // decode=fast|freeimage
+                            if (strcasecmp(value, "fast") == 0) {
+                                BlendFUtil::fastPng = true;
+                            } else if (strcasecmp(value, "freeimage") == 0) {
+                                BlendFUtil::fastPng = false;
+                            } else {
+                                std::cerr << "Unknown decode " << value << ", expect fast or freeimage" << std::endl;
+                                optionErrCnt++;
+                            }
+                        }
+                        break;
+
+                    case 'o':  // overlay=none|p32|lazy|tiled|premul|a16|planar|index
+                        if (ValidOption("overlay", cmd + 1, false)) {
+                            if (! blendCfg.setOverlayMode(value)) {
+                                optionErrCnt++;
+                            }
+                        } else if (ValidOption("openfiles", cmd + 1)) {
+                            // openfiles=<count>
+                            FMapFile::setBudget((unsigned)strtoul(value, nullptr, 10));
+                        }
+                        break;
+
+                    case 'm':  // mode=over|max|mean|last|hold
+                        if (ValidOption("mode", cmd + 1)) {
+                            if (! blendCfg.setTemporalMode(value)) {
+                                optionErrCnt++;
+                            }
+                        }
+                        break;
+
+                    case 'h':  // hold=<index>,<frames>
+                        if (ValidOption("hold", cmd + 1)) {
+                            if (! blendCfg.setHold(value)) {
+                                optionErrCnt++;
+                            }
+                        }
+                        break;
+
+                    case 'g':  // gamma=srgb|linear
+                        if (ValidOption("gamma", cmd + 1)) {
+                            if (! blendCfg.setGamma(value)) {
+                                optionErrCnt++;
+                            }
+                        }
+                        break;
+
+                    case 'l':  // layer=[dst-]<op>:<file>
+                        if (ValidOption("layer", cmd + 1)) {
+                            if (! blendCfg.addLayer(value)) {
+                                optionErrCnt++;
+                            }
+                        }
+                        break;
+
+                    case 'a':  // apng=<file>[,<delayMs>]
+                        if (ValidOption("apng", cmd + 1)) {
+                            Split apngArgs(value, ",");
+                            doBlendF.apngName = apngArgs.empty() ? "" : apngArgs[0];
+                            if (apngArgs.size() > 1) {
+                                doBlendF.apngDelay = (unsigned)strtoul(apngArgs[1], nullptr, 10);
+                            }
+                            if (doBlendF.apngName.empty() || doBlendF.apngDelay == 0) {
+                                std::cerr << "Animation needs -apng=<file>[,<delayMs>]" << std::endl;
+                                optionErrCnt++;
+                            }
+                        }
+                        break;
+
+                    case 'w':  // window=<frames>
+                        if (ValidOption("window", cmd + 1)) {
+                            doWindowF.windowFrames = (unsigned)strtoul(value, nullptr, 10);
+                            commandPtr = &doWindowF;
+                        }
+                        break;
+
+                    case 'f':  // final=<batch>
+                        if (ValidOption("final", cmd + 1)) {
+                            doBlendF.finalBatch = std::max(1u, (unsigned)strtoul(value, nullptr, 10));
+                        }
+                        break;
+
+                    case 't':  // threads=<count>
+                        if (ValidOption("threads", cmd + 1)) {
+                            if (! FThreadPool::setThreads((unsigned)strtoul(value, nullptr, 10))) {
+                                std::cerr << "Threads must be set before the thread pool is used" << std::endl;
+                                optionErrCnt++;
+                            }
+                        }
+                        break;
+
                     case 'c':  // excludeFile=<pat>
-                        if (ValidOption("config", cmd + 1)) {
+                        if (ValidOption("config", cmd + 1, false)) {
                             blendCfg.parseConfig(value);
                             blendCfg.print();
+                        } else if (ValidOption("class", cmd + 1, false)) {
+                            // class=<name>[:<first>-<last>][@<decay>]
+                            if (! blendCfg.addClass(value)) {
+                                optionErrCnt++;
+                            }
+                        } else if (ValidOption("chunks", cmd + 1)) {
+                            // chunks=<count>
+                            doBlendF.chunkCnt = (unsigned)strtoul(value, nullptr, 10);
                         }
                         break;
 
@@ -391,6 +581,20 @@ int main(int argc, char* argv[]) {
                         }
                         break;
 
+                    case 'b':
+                        if (ValidOption("bench", argStr + 1)) {
+                            commandPtr = &doBenchF;
+                            continue;
+                        }
+                        break;
+
+                    case 'm':
+                        if (ValidOption("maximum", argStr + 1)) {
+                            commandPtr = &doMaximumF;
+                            continue;
+                        }
+                        break;
+
                     }
 
                     if (endCmds == argv[argn]) {
@@ -406,6 +610,27 @@ int main(int argc, char* argv[]) {
             }
         }
 
+        if (! blendCfg.classes.empty() && commandPtr == &doBlendF) {
+            commandPtr = &doClassF;     // Classes from -class or config
+        }
+        if (! doBlendF.apngName.empty()
+            && (commandPtr != &doBlendF || doBlendF.finalBatch > 0 || doBlendF.chunkCnt > 1)) {
+            std::cerr << "Animation -apng only saves the frame by frame blend, not with -final, -chunks,"
+                " -class, -window or other commands" << std::endl;
+            optionErrCnt++;
+        }
+        if (blendCfg.linearLight) {
+            FKernel::selectLinear(true);
+            if (blendCfg.overlayMode == OVERLAY_LAZY || blendCfg.overlayMode == OVERLAY_PREMUL
+                || blendCfg.overlayMode == OVERLAY_A16 || blendCfg.temporalMode != TEMPORAL_OVER) {
+                std::cerr << "Linear gamma applies to -mode=over with -overlay=p32, tiled, planar or index,"
+                    " other overlay updates stay sRGB" << std::endl;
+            }
+        }
+        if (! BlendFUtil::LoadLayers(blendCfg)) {
+            optionErrCnt++;
+        }
+
         if (commandPtr->begin(fileDirList)) {
             time_t startT;
             std::cerr << "Start " << currentDateTime(startT) << std::endl;